@@ -7,13 +7,16 @@
 
 #include "sdk_compat.h"
 #include "WifiManager.h"
+#include "BootSequencer.h"
+#include "LazyFileSystem.h"
 
 /**
  * @class Application
  * @brief Main class responsible for orchestrating the application's lifecycle.
  *
  * This class handles the initialization of core services, including Non-Volatile Storage (NVS)
- * and LittleFS filesystem, and manages Wi-Fi connectivity through the WifiManager.
+ * and the LittleFS filesystem (mounted on first use unless LFS_MOUNT_AT_BOOT is set), and
+ * manages Wi-Fi connectivity through the WifiManager.
  */
 class Application {
 public:
@@ -27,8 +30,9 @@ public:
     /**
      * @brief Executes the main application logic.
      *
-     * This method initializes necessary components and enters an infinite loop
-     * to keep the application running.
+     * This method initializes necessary components, running independent steps
+     * concurrently, and then blocks on connectivity events from the WifiManager,
+     * handling each change as it happens.
      */
     void run();
 
@@ -41,14 +45,12 @@ private:
      */
     void initializeNVS();
 
-    /**
-     * @brief Initializes and mounts the LittleFS filesystem.
-     *
-     * Registers the LittleFS driver with the Virtual File System (VFS) using the
-     * base path defined in config.h, enabling file operations on the storage partition.
-     */
-    void initializeFS();
+    /** @brief LittleFS partition, mounted by whoever needs it first. Declared before @ref m_wifi, which uses it. */
+    LazyFileSystem m_fs;
 
     /** @brief Instance of WifiManager for handling Wi-Fi connectivity. */
     WifiManager m_wifi;
+
+    /** @brief Boot stages and their dependencies; a member so it outlives the stage tasks. */
+    BootSequencer m_boot;
 };
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+ * @file AssetCache.h
+ * @brief Declaration of the AssetCache class keeping web assets in RAM.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+#include "LazyFileSystem.h"
+
+/**
+ * @class AssetCache
+ * @brief Loads a fixed set of files from LittleFS into one contiguous buffer and serves them from there.
+ *
+ * Without the cache, every request pays for stat(), open() and a loop of small reads through
+ * the VFS and the littlefs block lookups. The cache reads each asset once, after the mount,
+ * and answers requests with a single httpd_resp_send(). Assets that would push the buffer past
+ * ASSET_CACHE_MAX_BYTES are not cached; send() reports them as misses so the caller can
+ * stream them instead. invalidate() drops the buffer after the filesystem has been updated;
+ * the next request loads it again.
+ *
+ * Several assets may share a path with different encodings (the ".gz" files produced by
+ * scripts/build_assets.py); send() picks the first one the client accepts.
+ *
+ * Each cached asset gets an ETag (a hash of its content, computed while loading) and is sent
+ * with ASSET_CACHE_CONTROL. A request whose If-None-Match lists the ETag is answered with
+ * 304 Not Modified and no body.
+ */
+class AssetCache {
+public:
+    /**
+     * @struct Asset
+     * @brief A file to cache.
+     */
+    struct Asset {
+        /** @brief Lookup key, the path the asset is requested by (e.g. "/index.html"). */
+        const char* path;
+        /** @brief File relative to LFS_BASE_PATH, starting with '/'. */
+        const char* file;
+        /** @brief Content type sent with the asset. */
+        const char* type;
+        /** @brief Content-Encoding of the file (e.g. "gzip"), or null if it is not encoded. */
+        const char* encoding;
+    };
+
+    /**
+     * @struct Stats
+     * @brief Cache counters.
+     */
+    struct Stats {
+        /** @brief Requests answered from the buffer. */
+        uint32_t hits;
+        /** @brief Requests for assets that are not cached. */
+        uint32_t misses;
+        /** @brief Hits answered with 304 Not Modified. */
+        uint32_t not_modified;
+        /** @brief Body bytes sent from the buffer. */
+        uint32_t bytes_sent;
+        /** @brief Number of times the buffer was (re)loaded. */
+        uint32_t loads;
+        /** @brief Bytes held in the buffer. */
+        size_t bytes;
+        /** @brief Duration of the last load in microseconds. */
+        uint32_t load_us;
+    };
+
+    /**
+     * @brief Constructs an empty AssetCache object.
+     *
+     * @param fs Filesystem to load from; mounted on first use.
+     * @param assets Files to cache; must outlive the cache. At most ASSET_CACHE_MAX_ENTRIES are used.
+     * @param count Number of entries in @p assets.
+     */
+    AssetCache(LazyFileSystem& fs, const Asset* assets, size_t count);
+
+    /**
+     * @brief Destroys the AssetCache object and frees the buffer.
+     */
+    ~AssetCache();
+
+    /**
+     * @brief Loads the assets into the buffer unless it is loaded already.
+     *
+     * @return esp_err_t ESP_OK if the buffer is loaded (possibly without the assets that did
+     *         not fit or could not be read), error code if the filesystem or allocation failed.
+     */
+    esp_err_t load();
+
+    /**
+     * @brief Drops the buffer; call after the files in the storage partition have changed.
+     */
+    void invalidate();
+
+    /**
+     * @brief Sends a cached asset as the complete response, loading the buffer if needed.
+     *
+     * Sets the content type, Content-Encoding of the chosen variant, Vary: Accept-Encoding,
+     * ETag and Cache-Control; answers with 304 Not Modified if If-None-Match matches the ETag.
+     *
+     * @param req HTTP request handle.
+     * @param path Path of the asset as given in Asset::path.
+     * @return esp_err_t Result of httpd_resp_send(), or ESP_ERR_NOT_FOUND if no acceptable
+     *         variant is cached; nothing has been sent in that case.
+     */
+    esp_err_t send(httpd_req_t* req, const char* path);
+
+    /**
+     * @brief Checks whether the client accepts gzip-encoded responses.
+     *
+     * @param req HTTP request handle.
+     * @return true if Accept-Encoding lists gzip without q=0.
+     */
+    static bool acceptsGzip(httpd_req_t* req);
+
+    /**
+     * @brief Checks whether the request's If-None-Match header matches an ETag.
+     *
+     * @param req HTTP request handle.
+     * @param etag Quoted ETag of the selected variant.
+     * @return true if the client's copy is current.
+     */
+    static bool matchesIfNoneMatch(httpd_req_t* req, const char* etag);
+
+    /**
+     * @brief Retrieves a copy of the counters.
+     *
+     * @return Stats Current counters.
+     */
+    Stats getStats() const;
+
+private:
+    /**
+     * @struct Entry
+     * @brief Location of an asset in the buffer.
+     */
+    struct Entry {
+        /** @brief Offset of the asset in @ref m_buffer. */
+        size_t offset;
+        /** @brief Size of the asset in bytes. */
+        size_t size;
+        /** @brief True if the asset was loaded. */
+        bool cached;
+        /** @brief Quoted content hash sent as ETag. */
+        char etag[11];
+    };
+
+    /** @brief Maximum number of cached assets. */
+    static constexpr size_t CAPACITY = ASSET_CACHE_MAX_ENTRIES;
+
+    /**
+     * @brief Reads the assets into a newly allocated buffer. Mutex must be held.
+     *
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t loadLocked();
+
+    /**
+     * @brief Frees the buffer and forgets all entries. Mutex must be held.
+     */
+    void releaseLocked();
+
+    /** @brief Filesystem to load from. */
+    LazyFileSystem& m_fs;
+
+    /** @brief Files to cache. */
+    const Asset* m_assets;
+
+    /** @brief Number of entries of @ref m_assets in use. */
+    size_t m_count;
+
+    /** @brief Location of each asset, indexed like @ref m_assets. */
+    Entry m_entries[CAPACITY];
+
+    /** @brief All cached assets back to back; null until loaded. */
+    uint8_t* m_buffer;
+
+    /** @brief True once the buffer has been loaded. */
+    bool m_loaded;
+
+    /** @brief Cache counters. */
+    Stats m_stats;
+
+    /** @brief Guards the buffer; held while a response is sent from it so invalidate() cannot free it. */
+    SemaphoreHandle_t m_mutex;
+};
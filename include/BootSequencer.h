@@ -0,0 +1,107 @@
+/**
+ * @file BootSequencer.h
+ * @brief Declaration of the BootSequencer class running boot stages along their dependencies.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class BootSequencer
+ * @brief Small dependency-graph executor for the boot sequence.
+ *
+ * Each stage runs on its own task as soon as the stages it depends on have finished, so
+ * independent stages (e.g. the LittleFS mount and the Wi-Fi driver init) overlap and may run
+ * on different cores. run() blocks until every stage has finished and then logs the time
+ * each stage waited and ran, the total boot time and the sequential sum for comparison.
+ */
+class BootSequencer {
+public:
+    /** @brief Stage body. */
+    using Action = std::function<void()>;
+
+    /** @brief Maximum number of stages. */
+    static constexpr size_t CAPACITY = BOOT_MAX_STAGES;
+
+    /**
+     * @brief Returns the dependency mask of a single stage.
+     *
+     * @param stage Identifier returned by add().
+     * @return uint32_t Mask to pass (or OR together) as @p depends_on of add().
+     */
+    static constexpr uint32_t after(size_t stage) { return 1u << stage; }
+
+    /**
+     * @brief Constructs a BootSequencer without stages.
+     */
+    BootSequencer();
+
+    /**
+     * @brief Destroys the BootSequencer object and its event group.
+     */
+    ~BootSequencer();
+
+    /**
+     * @brief Adds a stage. Stages may only depend on stages added before them.
+     *
+     * @param name Name used in the log; must outlive run().
+     * @param action Stage body.
+     * @param depends_on Mask of stages (see after()) that must finish first.
+     * @return size_t Identifier of the stage.
+     */
+    size_t add(const char* name, Action action, uint32_t depends_on = 0);
+
+    /**
+     * @brief Runs all stages and blocks until every one of them has finished.
+     *
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if a stage task could not be created
+     *         (that stage and its dependents are then run on the calling task).
+     */
+    esp_err_t run();
+
+private:
+    /**
+     * @struct Stage
+     * @brief One node of the boot graph.
+     */
+    struct Stage {
+        /** @brief Name used in the log. */
+        const char* name;
+        /** @brief Stage body. */
+        Action action;
+        /** @brief Mask of stages that must finish first. */
+        uint32_t depends_on;
+        /** @brief esp_timer timestamp at which the dependencies were satisfied. */
+        int64_t start_us;
+        /** @brief esp_timer timestamp at which the stage finished. */
+        int64_t end_us;
+        /** @brief Owning sequencer, passed to the stage task. */
+        BootSequencer* owner;
+        /** @brief Identifier of the stage. */
+        size_t index;
+    };
+
+    /**
+     * @brief Stage task entry; waits for the dependencies, runs the stage and signals it.
+     *
+     * @param arg Pointer to the Stage.
+     */
+    static void stageTask(void* arg);
+
+    /**
+     * @brief Waits for the dependencies of a stage, runs it and records its timings.
+     *
+     * @param stage The stage.
+     */
+    void execute(Stage& stage);
+
+    /** @brief Stages in the order they were added. */
+    Stage m_stages[CAPACITY];
+
+    /** @brief Number of stages added. */
+    size_t m_count;
+
+    /** @brief One bit per finished stage. */
+    EventGroupHandle_t m_done;
+};
@@ -0,0 +1,84 @@
+/**
+ * @file CaptiveDnsServer.h
+ * @brief Declaration of the CaptiveDnsServer class resolving every name to the provisioning AP.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+#include <atomic>
+
+/**
+ * @class CaptiveDnsServer
+ * @brief Minimal UDP DNS responder for the provisioning access point.
+ *
+ * Every A query is answered with the AP address, so the connectivity checks of phones and
+ * laptops reach the provisioning web server and the OS opens the page on its own. Other
+ * query types get an empty NOERROR answer, which makes clients fall back to IPv4 quickly.
+ * The socket is bound to the AP address only, so the station side is never served.
+ */
+class CaptiveDnsServer {
+public:
+    /**
+     * @brief Constructs a stopped CaptiveDnsServer object.
+     */
+    CaptiveDnsServer();
+
+    /**
+     * @brief Stops the responder.
+     */
+    ~CaptiveDnsServer();
+
+    /**
+     * @brief Starts the responder task. Does nothing if it is already running.
+     *
+     * @param address AP address to bind to and to return in every answer.
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the task could not be created.
+     */
+    esp_err_t start(esp_ip4_addr_t address);
+
+    /**
+     * @brief Stops the responder task and waits up to a few poll intervals for it to exit.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the number of queries answered since the last start.
+     *
+     * @return uint32_t Answered queries.
+     */
+    uint32_t answeredQueries() const;
+
+private:
+    /**
+     * @brief Task entry; receives queries until stop() is called.
+     *
+     * @param arg Pointer to the CaptiveDnsServer instance.
+     */
+    static void task(void* arg);
+
+    /**
+     * @brief Turns a query in @p packet into the answer in place.
+     *
+     * @param packet Buffer holding the query; receives the answer.
+     * @param length Length of the query.
+     * @param capacity Size of @p packet.
+     * @return size_t Length of the answer, 0 if the packet is not a query to answer.
+     */
+    size_t buildAnswer(uint8_t* packet, size_t length, size_t capacity) const;
+
+    /** @brief Address returned in every A record (network byte order). */
+    esp_ip4_addr_t m_address;
+
+    /** @brief Responder task, null while stopped. */
+    TaskHandle_t m_task;
+
+    /** @brief Cleared by stop() to make the task exit. */
+    std::atomic<bool> m_running;
+
+    /** @brief Set by the task right before it deletes itself. */
+    std::atomic<bool> m_exited;
+
+    /** @brief Queries answered since the last start. */
+    std::atomic<uint32_t> m_answered;
+};
@@ -0,0 +1,203 @@
+/**
+ * @file ConnectionStateMachine.h
+ * @brief Declaration of the ConnectionStateMachine class describing the Wi-Fi connection lifecycle.
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class ConnectionStateMachine
+ * @brief Pure, constexpr transition logic of the station connection lifecycle.
+ *
+ * The class holds no driver state and performs no side effects, so every transition can be
+ * verified at compile time (see the static_asserts at the end of this file). WifiManager
+ * feeds it events from its connection task and runs the entry action of each new state.
+ */
+class ConnectionStateMachine {
+public:
+    /**
+     * @brief Connection states.
+     */
+    enum class State : uint8_t {
+        Idle,         /**< Nothing started yet. */
+        Scanning,     /**< Scanning for stored networks. */
+        Connecting,   /**< Association or DHCP in progress. */
+        GotIP,        /**< Connected with an IP address. */
+        Backoff,      /**< Waiting for the next reconnection attempt. */
+        Provisioning  /**< Provisioning AP and web server running. */
+    };
+
+    /**
+     * @brief Events driving the transitions.
+     */
+    enum class Event : uint8_t {
+        Start,               /**< Stored networks exist; scan for them. */
+        FastConnect,         /**< A fast-connect record exists; connect without scanning. */
+        NoCredentials,       /**< No stored network. */
+        ScanDone,            /**< The scan found at least one stored network. */
+        NoCandidates,        /**< The scan found no stored network. */
+        GotIp,               /**< The station obtained an IP address. */
+        Disconnected,        /**< The link dropped and a retry was scheduled. */
+        RetryDue,            /**< The backoff delay elapsed. */
+        AttemptFailed,       /**< The attempt failed; another candidate is available. */
+        Rescan,              /**< The fast-connect attempt failed; fall back to a scan. */
+        CandidatesExhausted, /**< Every candidate failed (or the credentials under validation were rejected). */
+        CredentialsReceived, /**< Provisioning received credentials to validate while the AP stays up. */
+        AddressAssigned,     /**< The station interface got an address; WifiManager persists the lease. Never in the table. */
+        LeaseCheckDue,       /**< Time for the next ARP probe of a reused lease. Never in the table. */
+        LeaseExpired,        /**< The reused lease reached its expiry; DHCP takes over. Never in the table. */
+        HandoffDue           /**< The provisioning page had time to fetch the result; stop the AP. Never in the table. */
+    };
+
+    /**
+     * @struct Transition
+     * @brief One row of the transition table.
+     */
+    struct Transition {
+        /** @brief Source state. */
+        State from;
+        /** @brief Triggering event. */
+        Event event;
+        /** @brief Destination state. */
+        State to;
+    };
+
+    /** @brief Transition table; any (state, event) pair not listed is ignored. */
+    static constexpr Transition TRANSITIONS[] = {
+        {State::Idle,         Event::Start,               State::Scanning},
+        {State::Idle,         Event::FastConnect,         State::Connecting},
+        {State::Idle,         Event::NoCredentials,       State::Provisioning},
+        {State::Scanning,     Event::ScanDone,            State::Connecting},
+        {State::Scanning,     Event::NoCandidates,        State::Provisioning},
+        {State::Connecting,   Event::GotIp,               State::GotIP},
+        {State::Connecting,   Event::Disconnected,        State::Backoff},
+        {State::Connecting,   Event::AttemptFailed,       State::Connecting},
+        {State::Connecting,   Event::Rescan,              State::Scanning},
+        {State::Connecting,   Event::CandidatesExhausted, State::Provisioning},
+        {State::GotIP,        Event::Disconnected,        State::Backoff},
+        {State::Backoff,      Event::RetryDue,            State::Connecting},
+        {State::Backoff,      Event::GotIp,               State::GotIP},
+        {State::Provisioning, Event::CredentialsReceived, State::Connecting},
+    };
+
+    /**
+     * @brief Looks up the destination of a transition.
+     *
+     * @param from Source state.
+     * @param event Triggering event.
+     * @param to Output parameter for the destination state.
+     * @return true if the table contains the transition, false otherwise.
+     */
+    static constexpr bool lookup(State from, Event event, State& to) {
+        for (const Transition& t : TRANSITIONS) {
+            if (t.from == from && t.event == event) {
+                to = t.to;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Constructs a state machine in State::Idle.
+     */
+    constexpr ConnectionStateMachine() : m_state(State::Idle) {}
+
+    /**
+     * @brief Applies an event.
+     *
+     * @param event The event to apply.
+     * @return true if the event caused a transition, false if it was ignored.
+     */
+    constexpr bool dispatch(Event event) {
+        State to = m_state;
+        if (!lookup(m_state, event, to)) return false;
+        m_state = to;
+        return true;
+    }
+
+    /**
+     * @brief Returns the current state.
+     *
+     * @return State The current state.
+     */
+    constexpr State state() const { return m_state; }
+
+    /**
+     * @brief Returns a printable name of a state.
+     *
+     * @param state The state.
+     * @return const char* Static string.
+     */
+    static constexpr const char* toString(State state) {
+        switch (state) {
+            case State::Idle:         return "Idle";
+            case State::Scanning:     return "Scanning";
+            case State::Connecting:   return "Connecting";
+            case State::GotIP:        return "GotIP";
+            case State::Backoff:      return "Backoff";
+            case State::Provisioning: return "Provisioning";
+        }
+        return "?";
+    }
+
+    /**
+     * @brief Checks that no (state, event) pair appears twice in the table.
+     *
+     * @return true if the table is deterministic.
+     */
+    static constexpr bool isDeterministic() {
+        constexpr size_t count = sizeof(TRANSITIONS) / sizeof(TRANSITIONS[0]);
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = i + 1; j < count; j++) {
+                if (TRANSITIONS[i].from == TRANSITIONS[j].from && TRANSITIONS[i].event == TRANSITIONS[j].event) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    /** @brief Current state. */
+    State m_state;
+};
+
+/**
+ * @brief Runs a sequence of events through a fresh state machine.
+ *
+ * @param events Events to apply in order.
+ * @param count Number of events.
+ * @return ConnectionStateMachine::State The final state.
+ */
+constexpr ConnectionStateMachine::State simulateConnection(const ConnectionStateMachine::Event* events, size_t count) {
+    ConnectionStateMachine machine;
+    for (size_t i = 0; i < count; i++) {
+        machine.dispatch(events[i]);
+    }
+    return machine.state();
+}
+
+namespace connection_state_machine_checks {
+using S = ConnectionStateMachine::State;
+using E = ConnectionStateMachine::Event;
+
+constexpr E boot_via_scan[] = {E::Start, E::ScanDone, E::GotIp};
+constexpr E fast_connect_fallback[] = {E::FastConnect, E::Rescan, E::ScanDone, E::AttemptFailed, E::GotIp};
+constexpr E recovery[] = {E::Start, E::ScanDone, E::GotIp, E::Disconnected, E::RetryDue, E::Disconnected, E::RetryDue, E::GotIp};
+constexpr E all_failed[] = {E::Start, E::ScanDone, E::Disconnected, E::RetryDue, E::CandidatesExhausted};
+constexpr E ignored_in_provisioning[] = {E::NoCredentials, E::GotIp, E::Disconnected, E::RetryDue};
+constexpr E validation_accepted[] = {E::NoCredentials, E::CredentialsReceived, E::GotIp};
+constexpr E validation_rejected[] = {E::NoCredentials, E::CredentialsReceived, E::CandidatesExhausted, E::CredentialsReceived};
+
+static_assert(ConnectionStateMachine::isDeterministic(), "Duplicate (state, event) pair in transition table");
+static_assert(simulateConnection(boot_via_scan, 3) == S::GotIP, "Scan path must reach GotIP");
+static_assert(simulateConnection(fast_connect_fallback, 5) == S::GotIP, "Fast-connect fallback must reach GotIP");
+static_assert(simulateConnection(recovery, 8) == S::GotIP, "Backoff must recover to GotIP");
+static_assert(simulateConnection(all_failed, 5) == S::Provisioning, "Exhausted candidates must enter provisioning");
+static_assert(simulateConnection(ignored_in_provisioning, 4) == S::Provisioning, "Provisioning ignores link events");
+static_assert(simulateConnection(validation_accepted, 3) == S::GotIP, "Validated credentials must reach GotIP");
+static_assert(simulateConnection(validation_rejected, 4) == S::Connecting, "Rejected credentials must allow another attempt");
+}
@@ -0,0 +1,148 @@
+/**
+ * @file ConnectionTimingLog.h
+ * @brief Declaration of the ConnectionTimingLog class recording the phases of connection attempts.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class ConnectionTimingLog
+ * @brief Fixed ring buffer with the phase timings of the last connection attempts.
+ *
+ * An attempt runs from the connect call to IP_EVENT_STA_GOT_IP or a failure. The driver does
+ * not report authentication and association separately, so both (including the 4-way
+ * handshake) are one phase ending at WIFI_EVENT_STA_CONNECTED. DHCP runs from there to
+ * GOT_IP. The scan that selected the target, if any, is attributed to the attempt that follows.
+ *
+ * Hooks are called from the connection task and the event loop; readers take copies under
+ * a spinlock.
+ */
+class ConnectionTimingLog {
+public:
+    /** @brief Number of attempts kept. */
+    static constexpr size_t CAPACITY = CONNECTION_TIMING_HISTORY;
+
+    /** @brief Result value of an attempt that has not finished yet. */
+    static constexpr uint8_t RESULT_PENDING = 0xFF;
+
+    /** @brief Result value of a successful attempt; failures store the disconnect reason. */
+    static constexpr uint8_t RESULT_SUCCESS = 0;
+
+    /**
+     * @brief How an attempt was started.
+     */
+    enum class Kind : uint8_t {
+        Candidate,    /**< Directed connect to a scanned candidate. */
+        FastConnect,  /**< Connect from the fast-connect record, without a scan. */
+        Retry,        /**< Backoff retry after a disconnect. */
+        Validation    /**< Credentials submitted in provisioning mode. */
+    };
+
+    /**
+     * @struct Record
+     * @brief Phase timings of one attempt. Durations are 0 for phases that were not reached.
+     */
+    struct Record {
+        /** @brief Attempt number since boot, starting at 1. */
+        uint32_t sequence;
+        /** @brief esp_timer timestamp of the connect call. */
+        int64_t started_us;
+        /** @brief Duration of the scan preceding the attempt. */
+        uint32_t scan_ms;
+        /** @brief Authentication, association and key handshake, up to WIFI_EVENT_STA_CONNECTED. */
+        uint32_t associate_ms;
+        /** @brief From WIFI_EVENT_STA_CONNECTED to IP_EVENT_STA_GOT_IP. */
+        uint32_t dhcp_ms;
+        /** @brief From the connect call to GOT_IP or the failure. */
+        uint32_t total_ms;
+        /** @brief How the attempt was started. */
+        Kind kind;
+        /** @brief RESULT_SUCCESS, RESULT_PENDING or the disconnect reason. */
+        uint8_t result;
+        /** @brief Channel of the association, 0 if not associated. */
+        uint8_t channel;
+    };
+
+    /**
+     * @brief Constructs an empty ConnectionTimingLog object.
+     */
+    ConnectionTimingLog();
+
+    /**
+     * @brief Records the duration of a scan, attributed to the next attempt.
+     *
+     * @param duration_ms Scan duration.
+     */
+    void recordScan(uint32_t duration_ms);
+
+    /**
+     * @brief Opens a new record, overwriting the oldest one when the buffer is full.
+     *
+     * @param kind How the attempt was started.
+     */
+    void beginAttempt(Kind kind);
+
+    /**
+     * @brief Marks the end of the association phase of the open attempt.
+     *
+     * @param channel Channel of the association.
+     */
+    void onAssociated(uint8_t channel);
+
+    /**
+     * @brief Closes the open attempt as successful.
+     */
+    void onGotIp();
+
+    /**
+     * @brief Closes the open attempt as failed.
+     *
+     * @param reason Disconnect reason code.
+     */
+    void onFailed(uint8_t reason);
+
+    /**
+     * @brief Copies the recorded attempts, newest first.
+     *
+     * @param out Output array.
+     * @param max Capacity of @p out.
+     * @return size_t Number of records written.
+     */
+    size_t snapshot(Record* out, size_t max) const;
+
+    /**
+     * @brief Returns a printable name of an attempt kind.
+     *
+     * @param kind The kind.
+     * @return const char* Static string.
+     */
+    static const char* toString(Kind kind);
+
+private:
+    /**
+     * @brief Closes the open attempt and logs its phases. Lock must not be held.
+     *
+     * @param result RESULT_SUCCESS or the disconnect reason.
+     */
+    void close(uint8_t result);
+
+    /** @brief Ring buffer of attempts. */
+    Record m_records[CAPACITY];
+
+    /** @brief Number of attempts recorded since boot. */
+    uint32_t m_sequence;
+
+    /** @brief Scan duration waiting for the next attempt. */
+    uint32_t m_pending_scan_ms;
+
+    /** @brief True while the newest record is open. */
+    bool m_open;
+
+    /** @brief esp_timer timestamp of WIFI_EVENT_STA_CONNECTED of the open attempt. */
+    int64_t m_associated_us;
+
+    /** @brief Guards all members against concurrent access. */
+    mutable portMUX_TYPE m_lock;
+};
@@ -0,0 +1,220 @@
+/**
+ * @file CredentialStore.h
+ * @brief Declaration of the CredentialStore class for persisting multiple Wi-Fi networks.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class CredentialStore
+ * @brief Bounded table of known networks stored in NVS, with per-entry priority, IP mode and success history.
+ *
+ * Each entry is persisted as its own NVS blob so that updating one network (e.g. a new DHCP
+ * lease) rewrites only that entry. All methods are serialized by a recursive mutex, so the
+ * store may be used from the connection task and the HTTP server task alike.
+ */
+class CredentialStore {
+public:
+    /**
+     * @brief IP addressing mode of the station interface for a stored network.
+     */
+    enum class IpMode : uint8_t {
+        Dhcp = 0,       /**< Run a full DHCP exchange after every association. */
+        Static = 1,     /**< Use the stored static configuration, no DHCP. */
+        ReuseLease = 2  /**< Apply the last DHCP lease immediately while it is unexpired and check it with ARP; DHCP takes over at expiry. */
+    };
+
+    /**
+     * @struct IpSettings
+     * @brief IPv4 configuration persisted for static mode and for the last DHCP lease.
+     */
+    struct IpSettings {
+        /** @brief Address, netmask and gateway. */
+        esp_netif_ip_info_t ip_info;
+        /** @brief Primary DNS server. */
+        esp_ip4_addr_t dns;
+    };
+
+    /**
+     * @struct Network
+     * @brief One stored network. Stored verbatim as an NVS blob.
+     */
+    struct Network {
+        /** @brief SSID (null-terminated). */
+        char ssid[33];
+        /** @brief Passphrase or 64-digit hex PSK (null-terminated, empty for open networks). */
+        char password[65];
+        /** @brief User-assigned priority; higher values are preferred. */
+        uint8_t priority;
+        /** @brief IP addressing mode. */
+        IpMode ip_mode;
+        /** @brief Non-zero if @ref lease holds a valid lease. */
+        uint8_t lease_valid;
+        /**
+         * @brief Success sequence number of the last connection, 0 if never connected.
+         *
+         * The device has no real-time clock before SNTP, so "last success time" is kept as a
+         * monotonically increasing counter shared by all entries.
+         */
+        uint32_t last_success;
+        /** @brief Static configuration used in IpMode::Static. */
+        IpSettings static_ip;
+        /** @brief Last DHCP lease, reused in IpMode::ReuseLease. */
+        IpSettings lease;
+        /** @brief time() in seconds when @ref lease was granted; 0 if unknown. */
+        int64_t lease_granted;
+        /** @brief Duration of @ref lease in seconds as granted by the server; 0 if unknown, UINT32_MAX for infinite. */
+        uint32_t lease_seconds;
+    };
+
+    /**
+     * @struct Candidate
+     * @brief A stored network seen in a scan, with the strongest BSSID found for it.
+     */
+    struct Candidate {
+        /** @brief Index of the network in the store. */
+        size_t index;
+        /** @brief Ranking score; higher is better. */
+        int score;
+        /** @brief RSSI of the strongest BSSID. */
+        int8_t rssi;
+        /** @brief Strongest BSSID advertising the SSID. */
+        uint8_t bssid[6];
+        /** @brief Primary channel of that BSSID. */
+        uint8_t channel;
+    };
+
+    /** @brief Maximum number of stored networks. */
+    static constexpr size_t CAPACITY = CREDENTIAL_STORE_CAPACITY;
+
+    /**
+     * @brief Constructs an empty CredentialStore object.
+     */
+    CredentialStore();
+
+    /**
+     * @brief Destroys the CredentialStore object and its mutex.
+     */
+    ~CredentialStore();
+
+    /**
+     * @brief Loads the table from NVS, migrating the legacy single-network keys if present.
+     *
+     * @return esp_err_t ESP_OK on success (also when the table is empty), error code otherwise.
+     */
+    esp_err_t load();
+
+    /**
+     * @brief Returns the number of stored networks.
+     *
+     * @return size_t Number of used entries.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Looks up a network by SSID.
+     *
+     * @param ssid The SSID to look for.
+     * @return int Index of the network, or -1 if not stored.
+     */
+    int indexOf(const char* ssid) const;
+
+    /**
+     * @brief Copies a stored network.
+     *
+     * A copy rather than a reference, so the entry cannot change under the caller.
+     *
+     * @param index Index returned by indexOf() or a Candidate.
+     * @return Network Copy of the stored entry.
+     */
+    Network at(size_t index) const;
+
+    /**
+     * @brief Inserts a network or replaces the entry with the same SSID.
+     *
+     * When the table is full the entry with the lowest priority and oldest success is evicted.
+     * The success history and lease of a replaced entry are reset.
+     *
+     * @param network The network to store.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t upsert(const Network& network);
+
+    /**
+     * @brief Records a successful connection to a stored network.
+     *
+     * @param index Index of the network.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t markSuccess(size_t index);
+
+    /**
+     * @brief Stores a new DHCP lease for a network if it differs from the cached one.
+     *
+     * @param index Index of the network.
+     * @param lease The lease obtained via DHCP.
+     * @param granted time() in seconds when the lease was granted, 0 if unknown.
+     * @param seconds Lease duration in seconds, 0 if unknown.
+     * @return esp_err_t ESP_OK on success or if unchanged, error code otherwise.
+     */
+    esp_err_t updateLease(size_t index, const IpSettings& lease, int64_t granted, uint32_t seconds);
+
+    /**
+     * @brief Removes every stored network.
+     *
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t clear();
+
+    /**
+     * @brief Ranks the stored networks present in a scan result.
+     *
+     * The score combines the RSSI of the strongest BSSID, the entry priority and its success
+     * history (see CREDENTIAL_PRIORITY_WEIGHT and CREDENTIAL_RECENCY_BONUS).
+     *
+     * @param records Scan results.
+     * @param count Number of scan results.
+     * @param out Output array, sorted by descending score.
+     * @param max Capacity of @p out.
+     * @return size_t Number of candidates written.
+     */
+    size_t rank(const wifi_ap_record_t* records, size_t count, Candidate* out, size_t max) const;
+
+private:
+    /**
+     * @brief Writes one entry to NVS. The caller holds @ref m_mutex.
+     *
+     * @param index Index of the entry.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t persist(size_t index);
+
+    /**
+     * @brief Imports the legacy single-network keys into the table and erases them. The caller holds @ref m_mutex.
+     *
+     * @param nvs_handle Handle opened read-write on NVS_NAMESPACE.
+     */
+    void migrateLegacy(nvs_handle_t nvs_handle);
+
+    /**
+     * @brief Builds the NVS key of an entry.
+     *
+     * @param index Index of the entry.
+     * @param key Output buffer of at least 8 bytes.
+     */
+    static void entryKey(size_t index, char* key);
+
+    /** @brief Stored networks. */
+    Network m_networks[CAPACITY];
+
+    /** @brief Occupancy of @ref m_networks. */
+    bool m_used[CAPACITY];
+
+    /** @brief Highest success sequence number handed out so far. */
+    uint32_t m_success_seq;
+
+    /** @brief Serializes access to the table; recursive because upsert() and load() call other methods. */
+    SemaphoreHandle_t m_mutex;
+};
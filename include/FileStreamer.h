@@ -0,0 +1,146 @@
+/**
+ * @file FileStreamer.h
+ * @brief Declaration of the FileStreamer class sending files as Content-Length responses.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class FileStreamer
+ * @brief Streams files to HTTP clients in large chunks from one heap buffer.
+ *
+ * httpd_resp_send_chunk() costs a socket send per call plus the chunk framing, and reading
+ * into a small stack buffer multiplies the VFS calls. FileStreamer instead writes the status
+ * line and headers itself with the Content-Length known from fstat(), then passes the file to
+ * httpd_send() in chunks of up to FILE_STREAM_BUFFER_SIZE bytes. Because the header block is
+ * written here, headers set earlier with httpd_resp_set_hdr() are not sent; callers describe
+ * them in a Response instead.
+ *
+ * esp_http_server runs every handler on its single task, so at most one response streams at a
+ * time. The buffer is allocated on first use and kept, so the httpd task stack stays small.
+ * Throughput is recorded per chunk size (see SWEEP_SIZES).
+ */
+class FileStreamer {
+public:
+    /** @brief Chunk sizes whose throughput is recorded; FILE_STREAM_SWEEP cycles through them. */
+    static constexpr size_t SWEEP_SIZES[] = {256, 512, 1024, 2048, 4096};
+
+    /** @brief Number of entries in SWEEP_SIZES. */
+    static constexpr size_t SWEEP_COUNT = sizeof(SWEEP_SIZES) / sizeof(SWEEP_SIZES[0]);
+
+    /**
+     * @struct Response
+     * @brief Status line and headers of a streamed response.
+     */
+    struct Response {
+        /** @brief Status, e.g. "200 OK" or "206 Partial Content". */
+        const char* status = "200 OK";
+        /** @brief Content type. */
+        const char* type = "application/octet-stream";
+        /** @brief Content-Encoding, or null. */
+        const char* encoding = nullptr;
+        /** @brief Content-Range value, or null. */
+        const char* content_range = nullptr;
+        /** @brief Cache-Control value, or null. */
+        const char* cache_control = nullptr;
+        /** @brief Quoted ETag value, or null. */
+        const char* etag = nullptr;
+        /** @brief True to send Accept-Ranges: bytes. */
+        bool accept_ranges = false;
+        /** @brief True to send Vary: Accept-Encoding. */
+        bool vary_encoding = true;
+    };
+
+    /**
+     * @struct Throughput
+     * @brief Totals for one chunk size.
+     */
+    struct Throughput {
+        /** @brief Responses streamed. */
+        uint32_t responses;
+        /** @brief Body bytes sent. */
+        uint32_t bytes;
+        /** @brief Time spent reading and sending the bodies, in microseconds. */
+        uint64_t us;
+    };
+
+    /**
+     * @brief Constructs a FileStreamer without a buffer and with the FILE_STREAM_CHUNK_SIZE chunk size.
+     */
+    FileStreamer();
+
+    /**
+     * @brief Frees the buffer.
+     */
+    ~FileStreamer();
+
+    /**
+     * @brief Sends a whole file as the complete response.
+     *
+     * @param req HTTP request handle.
+     * @param filepath Absolute path of the file.
+     * @param response Status line and headers.
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the file cannot be opened
+     *         (nothing has been sent in that case), error code otherwise.
+     */
+    esp_err_t sendFile(httpd_req_t* req, const char* filepath, const Response& response);
+
+    /**
+     * @brief Sends a byte range of an open file as the complete response.
+     *
+     * Must be called from the httpd task, which is what makes the single buffer safe.
+     *
+     * @param req HTTP request handle.
+     * @param fd Open file; not closed.
+     * @param offset First byte to send.
+     * @param length Number of bytes to send; the Content-Length.
+     * @param response Status line and headers.
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the buffer cannot be allocated
+     *         (nothing has been sent in that case), error code otherwise.
+     */
+    esp_err_t stream(httpd_req_t* req, int fd, size_t offset, size_t length, const Response& response);
+
+    /**
+     * @brief Sets the chunk size of later responses.
+     *
+     * @param size Bytes per read and send, clamped to 1..FILE_STREAM_BUFFER_SIZE.
+     */
+    void setChunkSize(size_t size);
+
+    /**
+     * @brief Copies the throughput totals, indexed like SWEEP_SIZES.
+     *
+     * Each response is counted under the largest sweep size not above its chunk size.
+     *
+     * @param out Output array of SWEEP_COUNT entries.
+     */
+    void getThroughput(Throughput* out) const;
+
+private:
+    /**
+     * @brief Sends all bytes on the request's socket.
+     *
+     * @param req HTTP request handle.
+     * @param data Bytes to send.
+     * @param length Number of bytes.
+     * @return esp_err_t ESP_OK on success, ESP_FAIL if the socket failed.
+     */
+    static esp_err_t sendAll(httpd_req_t* req, const char* data, size_t length);
+
+    /** @brief Read buffer of FILE_STREAM_BUFFER_SIZE bytes; null until first used. Only touched by the httpd task. */
+    uint8_t* m_buffer;
+
+    /** @brief Bytes per read and send. */
+    size_t m_chunk_size;
+
+    /** @brief Next index into SWEEP_SIZES when FILE_STREAM_SWEEP is set. */
+    size_t m_sweep_next;
+
+    /** @brief Throughput totals, indexed like SWEEP_SIZES. */
+    Throughput m_throughput[SWEEP_COUNT];
+
+    /** @brief Protects the chunk size and totals. */
+    mutable portMUX_TYPE m_lock;
+};
@@ -0,0 +1,132 @@
+/**
+ * @file FlashAssetStore.h
+ * @brief Declaration of the FlashAssetStore class serving assets from a memory-mapped partition.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class FlashAssetStore
+ * @brief Serves web assets straight from a read-only partition mapped into the data address space.
+ *
+ * scripts/build_assets.py packs the minified and gzipped assets into an image that is flashed
+ * to the FLASH_ASSETS_PARTITION_LABEL partition. begin() maps the whole partition with
+ * esp_partition_mmap() once; send() then hands a pointer into the mapped flash to
+ * httpd_resp_send(), so a response needs neither the filesystem, a copy nor heap memory.
+ *
+ * Image layout (little endian): a Header, Header::count Entry records, then the file data.
+ * Entries sharing a path are variants of one asset; send() picks the first one the client
+ * accepts, so the packer lists the gzip variant first. Each entry carries the FNV-1a hash of
+ * its data, sent as ETag; a matching If-None-Match is answered with 304 Not Modified.
+ */
+class FlashAssetStore {
+public:
+    /**
+     * @struct Stats
+     * @brief Serve counters.
+     */
+    struct Stats {
+        /** @brief Responses sent from the partition (including 304 answers). */
+        uint32_t hits;
+        /** @brief Hits answered with 304 Not Modified. */
+        uint32_t not_modified;
+        /** @brief Body bytes sent from the partition. */
+        uint32_t bytes_sent;
+        /** @brief Total time spent in httpd_resp_send() for bodies, in microseconds. */
+        uint64_t send_us;
+    };
+
+    /**
+     * @brief Constructs an unmapped FlashAssetStore object.
+     */
+    FlashAssetStore();
+
+    /**
+     * @brief Unmaps the partition.
+     */
+    ~FlashAssetStore();
+
+    /**
+     * @brief Maps the asset partition and validates the image. Idempotent.
+     *
+     * @return esp_err_t ESP_OK if the image is mapped, ESP_ERR_NOT_FOUND if the partition is
+     *         missing, ESP_ERR_INVALID_STATE if it holds no valid image, mapping error otherwise.
+     */
+    esp_err_t begin();
+
+    /**
+     * @brief Sends an asset as the complete response.
+     *
+     * @param req HTTP request handle.
+     * @param path Request path, e.g. "/index.html"; a query string is ignored.
+     * @return esp_err_t Result of httpd_resp_send(), or ESP_ERR_NOT_FOUND if the store is not
+     *         mapped or holds no acceptable variant; nothing has been sent in that case.
+     */
+    esp_err_t send(httpd_req_t* req, const char* path);
+
+    /**
+     * @brief Retrieves a copy of the counters.
+     *
+     * @return Stats Current counters.
+     */
+    Stats getStats() const;
+
+private:
+    /** @brief Image magic, "AST1". */
+    static constexpr uint32_t MAGIC = 0x31545341;
+
+    /** @brief Entry flag: the data is gzip-encoded. */
+    static constexpr uint8_t FLAG_GZIP = 0x01;
+
+    /**
+     * @struct Header
+     * @brief Start of the image.
+     */
+    struct Header {
+        /** @brief MAGIC. */
+        uint32_t magic;
+        /** @brief Number of entries following the header. */
+        uint32_t count;
+    };
+
+    /**
+     * @struct Entry
+     * @brief Directory record of one asset variant.
+     */
+    struct Entry {
+        /** @brief Request path, NUL-padded. */
+        char path[32];
+        /** @brief Offset of the data from the start of the image. */
+        uint32_t offset;
+        /** @brief Size of the data in bytes. */
+        uint32_t size;
+        /** @brief FNV-1a hash of the data. */
+        uint32_t hash;
+        /** @brief FLAG_* bits. */
+        uint8_t flags;
+        /** @brief Padding to a 4-byte multiple. */
+        uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(Header) == 8 && sizeof(Entry) == 48, "Must match the layout written by scripts/build_assets.py");
+
+    /** @brief Start of the mapped image; null until begin() succeeded. */
+    const uint8_t* m_image;
+
+    /** @brief First directory entry. */
+    const Entry* m_entries;
+
+    /** @brief Number of directory entries. */
+    uint32_t m_count;
+
+    /** @brief Handle of the mapping. */
+    esp_partition_mmap_handle_t m_mmap;
+
+    /** @brief Serve counters. */
+    Stats m_stats;
+
+    /** @brief Protects @ref m_stats. */
+    mutable portMUX_TYPE m_lock;
+};
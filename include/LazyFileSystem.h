@@ -0,0 +1,60 @@
+/**
+ * @file LazyFileSystem.h
+ * @brief Declaration of the LazyFileSystem class mounting LittleFS on first use.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+#include <atomic>
+
+/**
+ * @class LazyFileSystem
+ * @brief Mounts the LittleFS partition the first time a caller needs it.
+ *
+ * A device that connects straight away never serves files, so the mount (and a possible
+ * format on first boot) is only paid for when provisioning starts or a handler asks for a
+ * file. Callers from any task may race; the first one mounts, the others wait for it.
+ */
+class LazyFileSystem {
+public:
+    /**
+     * @brief Constructs an unmounted LazyFileSystem object.
+     */
+    LazyFileSystem();
+
+    /**
+     * @brief Destroys the LazyFileSystem object and its mutex. The filesystem stays mounted.
+     */
+    ~LazyFileSystem();
+
+    /**
+     * @brief Mounts the filesystem at LFS_BASE_PATH unless it is mounted already.
+     *
+     * A failed mount is retried on the next call.
+     *
+     * @return esp_err_t ESP_OK if the filesystem is mounted, error code otherwise.
+     */
+    esp_err_t ensureMounted();
+
+    /**
+     * @brief Checks whether the filesystem has been mounted.
+     *
+     * @return true if mounted, false otherwise.
+     */
+    bool isMounted() const;
+
+private:
+    /**
+     * @brief Registers LittleFS with the VFS and logs the partition usage.
+     *
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t mount();
+
+    /** @brief Serializes mount attempts. */
+    SemaphoreHandle_t m_mutex;
+
+    /** @brief True once the mount succeeded; released after the mount, acquired by the unlocked fast path. */
+    std::atomic<bool> m_mounted;
+};
@@ -0,0 +1,103 @@
+/**
+ * @file LinkEventPublisher.h
+ * @brief Declaration of the LinkEventPublisher class delivering connectivity events to subscriber queues.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class LinkEventPublisher
+ * @brief Fixed set of subscriber queues receiving typed connectivity events.
+ *
+ * Subscribers own their FreeRTOS queue (item size sizeof(LinkEvent)) and block on it.
+ * Publishing never blocks: if a subscriber's queue is full the event is dropped for that
+ * subscriber and counted, so a slow consumer cannot stall the Wi-Fi event loop.
+ */
+class LinkEventPublisher {
+public:
+    /** @brief Maximum number of subscribers. */
+    static constexpr size_t CAPACITY = LINK_EVENT_MAX_SUBSCRIBERS;
+
+    /**
+     * @brief Kind of connectivity change.
+     */
+    enum class Type : uint8_t {
+        Up,         /**< The station obtained an IP address. */
+        Down,       /**< The link with an IP address was lost. */
+        IpChanged,  /**< The address changed while connected (e.g. DHCP replaced a reused lease). */
+        Roamed      /**< The station moved to another BSSID of the same network. */
+    };
+
+    /**
+     * @struct LinkEvent
+     * @brief One connectivity change with the link parameters at the time it happened.
+     */
+    struct LinkEvent {
+        /** @brief Kind of change. */
+        Type type;
+        /** @brief Disconnect reason for Type::Down, 0 otherwise. */
+        uint8_t reason;
+        /** @brief RSSI in dBm, 0 if unknown. */
+        int8_t rssi;
+        /** @brief Channel of the association. */
+        uint8_t channel;
+        /** @brief BSSID of the association. */
+        uint8_t bssid[6];
+        /** @brief Station IP address, 0 for Type::Down. */
+        esp_ip4_addr_t ip;
+    };
+
+    /**
+     * @brief Constructs a LinkEventPublisher object without subscribers.
+     */
+    LinkEventPublisher();
+
+    /**
+     * @brief Adds a subscriber queue.
+     *
+     * @param queue Queue created with an item size of sizeof(LinkEvent).
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if all slots are taken.
+     */
+    esp_err_t subscribe(QueueHandle_t queue);
+
+    /**
+     * @brief Removes a subscriber queue.
+     *
+     * @param queue Queue passed to subscribe().
+     */
+    void unsubscribe(QueueHandle_t queue);
+
+    /**
+     * @brief Delivers an event to every subscriber without blocking.
+     *
+     * @param event The event.
+     */
+    void publish(const LinkEvent& event);
+
+    /**
+     * @brief Returns the number of events dropped because a subscriber queue was full.
+     *
+     * @return uint32_t Dropped events since boot.
+     */
+    uint32_t droppedEvents() const;
+
+    /**
+     * @brief Returns a printable name of an event type.
+     *
+     * @param type The type.
+     * @return const char* Static string.
+     */
+    static const char* toString(Type type);
+
+private:
+    /** @brief Subscriber queues; unused slots are null. */
+    QueueHandle_t m_queues[CAPACITY];
+
+    /** @brief Events dropped because a queue was full. */
+    uint32_t m_dropped;
+
+    /** @brief Guards @ref m_queues and @ref m_dropped. */
+    mutable portMUX_TYPE m_lock;
+};
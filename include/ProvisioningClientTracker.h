@@ -0,0 +1,168 @@
+/**
+ * @file ProvisioningClientTracker.h
+ * @brief Declaration of the ProvisioningClientTracker class enforcing per-client fairness on the provisioning server.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class ProvisioningClientTracker
+ * @brief Tracks HTTP sessions and stations of the provisioning server.
+ *
+ * Every session is mapped to the station (IPv4 address) that opened it. Each request
+ * refreshes the session's activity time and draws from the station's request budget, so a
+ * client that floods the server is answered with 429 while the others are still served, and
+ * sessions left open by a stuck client can be found and closed. Page-serve latencies are
+ * recorded per number of active stations.
+ *
+ * Hooks are called from the httpd task and the idle-check timer; all state is guarded by a
+ * spinlock.
+ */
+class ProvisioningClientTracker {
+public:
+    /** @brief Maximum number of tracked sessions. */
+    static constexpr size_t SESSION_CAPACITY = PROV_HTTPD_MAX_SOCKETS;
+
+    /** @brief Maximum number of tracked stations; every session may belong to a different one. */
+    static constexpr size_t STATION_CAPACITY = SESSION_CAPACITY;
+
+    /** @brief Number of latency buckets; the last one collects all higher client counts. */
+    static constexpr size_t LATENCY_BUCKETS = 4;
+
+    /**
+     * @struct Latency
+     * @brief Page-serve latency for one number of active stations.
+     */
+    struct Latency {
+        /** @brief Pages served. */
+        uint32_t count;
+        /** @brief Sum of the serve times, in microseconds. */
+        uint64_t total_us;
+        /** @brief Longest serve time, in microseconds. */
+        uint32_t max_us;
+    };
+
+    /**
+     * @struct Stats
+     * @brief Counters since the last reset().
+     */
+    struct Stats {
+        /** @brief Requests admitted. */
+        uint32_t requests;
+        /** @brief Requests answered with 429 because the station exceeded its budget. */
+        uint32_t rejected;
+        /** @brief Sessions closed because they were idle. */
+        uint32_t evicted;
+        /** @brief Latency by active stations; index i covers i + 1 stations. */
+        Latency latency[LATENCY_BUCKETS];
+    };
+
+    /**
+     * @brief Constructs an empty ProvisioningClientTracker object.
+     */
+    ProvisioningClientTracker();
+
+    /**
+     * @brief Forgets all sessions, stations and counters.
+     */
+    void reset();
+
+    /**
+     * @brief Registers a new session.
+     *
+     * @param sockfd Socket of the session.
+     * @param address IPv4 address of the peer (network byte order).
+     * @return true if the session is tracked, false if a table is full.
+     */
+    bool onOpen(int sockfd, uint32_t address);
+
+    /**
+     * @brief Unregisters a session.
+     *
+     * @param sockfd Socket of the session.
+     */
+    void onClose(int sockfd);
+
+    /**
+     * @brief Records a request on a session and charges it to the station's budget.
+     *
+     * @param sockfd Socket of the session.
+     * @return true if the request may be served, false if the station exceeded its budget.
+     */
+    bool admit(int sockfd);
+
+    /**
+     * @brief Collects sessions without a request for PROV_CLIENT_IDLE_TIMEOUT_MS and counts them as evicted.
+     *
+     * @param out Output array of sockets to close.
+     * @param max Capacity of @p out.
+     * @return size_t Number of sockets written.
+     */
+    size_t collectIdle(int* out, size_t max);
+
+    /**
+     * @brief Records the serve time of a page.
+     *
+     * @param duration_us Serve time in microseconds.
+     * @return size_t Number of stations with an open session at the time.
+     */
+    size_t recordServe(uint32_t duration_us);
+
+    /**
+     * @brief Retrieves a copy of the counters.
+     *
+     * @return Stats Current counters.
+     */
+    Stats getStats() const;
+
+private:
+    /**
+     * @struct Session
+     * @brief One open HTTP session.
+     */
+    struct Session {
+        /** @brief Socket, -1 if the slot is free. */
+        int sockfd;
+        /** @brief Index into @ref m_stations. */
+        uint8_t station;
+        /** @brief esp_timer timestamp of the last request (or of the accept). */
+        int64_t last_activity_us;
+    };
+
+    /**
+     * @struct Station
+     * @brief One AP client.
+     */
+    struct Station {
+        /** @brief IPv4 address (network byte order), 0 if the slot is free. */
+        uint32_t address;
+        /** @brief Open sessions of the station. */
+        uint8_t sessions;
+        /** @brief Requests in the current budget window. */
+        uint16_t requests;
+        /** @brief esp_timer timestamp of the start of the budget window. */
+        int64_t window_start_us;
+    };
+
+    /**
+     * @brief Finds the slot of a session. Lock must be held.
+     *
+     * @param sockfd Socket of the session.
+     * @return Session* The slot, or null.
+     */
+    Session* findSessionLocked(int sockfd);
+
+    /** @brief Session table. */
+    Session m_sessions[SESSION_CAPACITY];
+
+    /** @brief Station table. */
+    Station m_stations[STATION_CAPACITY];
+
+    /** @brief Counters exposed through getStats(). */
+    Stats m_stats;
+
+    /** @brief Guards all members against concurrent access. */
+    mutable portMUX_TYPE m_lock;
+};
@@ -0,0 +1,185 @@
+/**
+ * @file ReconnectScheduler.h
+ * @brief Declaration of the ReconnectScheduler class for timed station reconnection.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+
+/**
+ * @class ReconnectScheduler
+ * @brief Schedules station reconnection attempts with exponential backoff and jitter.
+ *
+ * Disconnect reasons are grouped into categories, each with its own retry budget and
+ * minimum delay. Until the first successful connection a category's budget limits the
+ * attempts, so permanent failures (wrong password, unknown SSID) are given up at once;
+ * once the device has been connected, attempts continue indefinitely in the background
+ * with the delay capped at the configured maximum.
+ */
+class ReconnectScheduler {
+public:
+    /**
+     * @brief Disconnect reason categories.
+     */
+    enum class Category : uint8_t {
+        AuthFailure,  /**< Authentication or key handshake failed; usually a wrong password. */
+        NoApFound,    /**< No AP with the SSID (and acceptable security) was found. */
+        Transient,    /**< Beacon loss, timeouts and other failures likely to clear on their own. */
+        ApKick        /**< The AP deauthenticated, disassociated or refused the station. */
+    };
+
+    /**
+     * @struct Policy
+     * @brief Backoff parameters.
+     */
+    struct Policy {
+        /** @brief Delay before the first attempt. */
+        uint32_t base_delay_ms;
+        /** @brief Upper bound for the delay. */
+        uint32_t max_delay_ms;
+        /** @brief Factor applied to the delay after every attempt. */
+        uint32_t multiplier;
+        /** @brief Random jitter in percent of the delay (+/-). */
+        uint32_t jitter_percent;
+    };
+
+    /**
+     * @struct Stats
+     * @brief Counters describing reconnection activity.
+     */
+    struct Stats {
+        /** @brief Attempts scheduled since boot. */
+        uint32_t total_attempts;
+        /** @brief Attempts scheduled since the link was last up. */
+        uint32_t current_attempts;
+        /** @brief Number of completed recoveries after a lost connection. */
+        uint32_t recoveries;
+        /** @brief Attempts the last recovery needed. */
+        uint32_t last_recovery_attempts;
+        /** @brief Duration of the last recovery, from disconnect to reconnect. */
+        int64_t last_recovery_ms;
+        /** @brief Reason code of the last disconnect. */
+        uint8_t last_reason;
+        /** @brief Category of the last disconnect. */
+        Category last_category;
+    };
+
+    /**
+     * @brief Constructs a new ReconnectScheduler object.
+     *
+     * @param policy Backoff parameters.
+     */
+    explicit ReconnectScheduler(const Policy& policy);
+
+    /**
+     * @brief Destroys the ReconnectScheduler object and its timer.
+     */
+    ~ReconnectScheduler();
+
+    /**
+     * @brief Creates the backing esp_timer. Must be called once esp_timer is available.
+     *
+     * @param on_retry Callback invoked from the esp_timer task when an attempt is due;
+     *                 if null, esp_wifi_connect() is called directly.
+     * @param arg Argument passed to @p on_retry.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t init(void (*on_retry)(void*) = nullptr, void* arg = nullptr);
+
+    /**
+     * @brief Schedules the next reconnection attempt after a disconnect.
+     *
+     * @param reason Disconnect reason from wifi_event_sta_disconnected_t.
+     * @return true if an attempt was scheduled, false if the retry budget of the reason's category is exhausted.
+     */
+    bool schedule(uint8_t reason);
+
+    /**
+     * @brief Records a successful connection and resets the backoff.
+     */
+    void onConnected();
+
+    /**
+     * @brief Cancels any pending attempt and forgets budgets and connection history.
+     *
+     * Used when a fresh connection attempt with (possibly new) credentials begins.
+     */
+    void reset();
+
+    /**
+     * @brief Cancels any pending attempt without touching counters.
+     */
+    void cancel();
+
+    /**
+     * @brief Retrieves a copy of the reconnection counters.
+     *
+     * @return Stats Current counters.
+     */
+    Stats getStats() const;
+
+    /**
+     * @brief Maps a disconnect reason to its category.
+     *
+     * @param reason Disconnect reason code.
+     * @return Category The category; Transient for reasons not listed explicitly.
+     */
+    static Category classify(uint8_t reason);
+
+    /**
+     * @brief Returns a printable name of a category.
+     *
+     * @param category The category.
+     * @return const char* Static string.
+     */
+    static const char* toString(Category category);
+
+private:
+    /**
+     * @brief esp_timer callback that issues the reconnection attempt.
+     *
+     * @param arg Pointer to the ReconnectScheduler instance.
+     */
+    static void timerCallback(void* arg);
+
+    /**
+     * @brief Computes the delay for the current attempt including jitter.
+     *
+     * @param min_delay_ms Lower bound of the delay before jitter.
+     * @return uint32_t Delay in milliseconds.
+     */
+    uint32_t nextDelayMs(uint32_t min_delay_ms) const;
+
+    /** @brief Number of categories. */
+    static constexpr size_t CATEGORY_COUNT = 4;
+
+    /** @brief Backoff parameters. */
+    Policy m_policy;
+
+    /** @brief One-shot timer driving the attempts. */
+    esp_timer_handle_t m_timer;
+
+    /** @brief Callback invoked when an attempt is due. */
+    void (*m_on_retry)(void*);
+
+    /** @brief Argument passed to @ref m_on_retry. */
+    void* m_on_retry_arg;
+
+    /** @brief Attempts per category since the last fresh start. */
+    uint8_t m_budget_used[CATEGORY_COUNT];
+
+    /** @brief Backoff exponent of the next attempt. */
+    uint32_t m_backoff_step;
+
+    /** @brief True once the first connection succeeded; budgets no longer apply. */
+    bool m_ever_connected;
+
+    /** @brief esp_timer timestamp of the disconnect that started the current outage. */
+    int64_t m_outage_start_us;
+
+    /** @brief Counters exposed through getStats(). */
+    Stats m_stats;
+
+    /** @brief Guards @ref m_stats against concurrent readers. */
+    mutable portMUX_TYPE m_lock;
+};
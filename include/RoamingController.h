@@ -0,0 +1,215 @@
+/**
+ * @file RoamingController.h
+ * @brief Declaration of the RoamingController class for moving between access points of one network.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+
+/**
+ * @class RoamingController
+ * @brief Moves the station to a stronger BSSID of the same SSID when the signal degrades.
+ *
+ * The driver reports WIFI_EVENT_STA_BSS_RSSI_LOW once the RSSI falls below the threshold.
+ * The controller then escalates through the available mechanisms, one per trigger:
+ * an 802.11v BSS transition query (the AP steers the station), an 802.11k neighbor report
+ * (scan only the channels the AP reports), and finally a full background scan. Scans return
+ * to the home channel between channels, so traffic continues while they run. A roam
+ * reassociates directly to the chosen BSSID; with 802.11r the supplicant performs a fast BSS
+ * transition. 802.11k/v/r are used only when enabled in sdkconfig and supported by the AP.
+ *
+ * All event hooks must be called from the default event loop.
+ */
+class RoamingController {
+public:
+    /**
+     * @struct Policy
+     * @brief Roaming parameters.
+     */
+    struct Policy {
+        /** @brief RSSI in dBm below which roaming is triggered. */
+        int8_t rssi_threshold;
+        /** @brief Minimum RSSI improvement in dB a candidate must offer. */
+        uint8_t min_rssi_gain;
+        /** @brief Delay before the threshold is re-armed after an attempt. */
+        uint32_t retrigger_ms;
+    };
+
+    /**
+     * @struct Stats
+     * @brief Counters describing roaming activity.
+     */
+    struct Stats {
+        /** @brief Number of low-RSSI triggers handled. */
+        uint32_t triggers;
+        /** @brief Completed roams. */
+        uint32_t roams;
+        /** @brief Roams that ended in a disconnect or were never answered. */
+        uint32_t failed_roams;
+        /** @brief BSS transition queries sent (802.11v). */
+        uint32_t btm_queries;
+        /** @brief Neighbor reports requested (802.11k). */
+        uint32_t neighbor_requests;
+        /** @brief Duration of the last roam, from the roam decision to reassociation. */
+        int64_t last_roam_ms;
+        /** @brief RSSI before the last roam. */
+        int8_t last_rssi_before;
+        /** @brief RSSI of the target seen in the scan before the last roam (0 if AP-steered). */
+        int8_t last_rssi_after;
+    };
+
+    /**
+     * @brief Constructs a new RoamingController object, disabled.
+     *
+     * @param policy Roaming parameters.
+     */
+    explicit RoamingController(const Policy& policy);
+
+    /**
+     * @brief Destroys the RoamingController object and its timer.
+     */
+    ~RoamingController();
+
+    /**
+     * @brief Creates the re-arm timer. Must be called once esp_timer is available.
+     *
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t init();
+
+    /**
+     * @brief Enables or disables roaming. Takes effect at the next association.
+     *
+     * @param enabled True to enable roaming.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Returns whether roaming is enabled.
+     *
+     * @return true if enabled.
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Sets the 802.11k/v/r capability flags of a station configuration.
+     *
+     * @param sta The station configuration passed to esp_wifi_set_config().
+     */
+    void applyTo(wifi_sta_config_t& sta) const;
+
+    /**
+     * @brief Handles WIFI_EVENT_STA_CONNECTED: completes a pending roam and arms the threshold.
+     *
+     * @param bssid BSSID the station associated with.
+     * @return true if the association completed a roam to another BSSID.
+     */
+    bool onConnected(const uint8_t* bssid);
+
+    /**
+     * @brief Handles WIFI_EVENT_STA_DISCONNECTED.
+     *
+     * @param reason Disconnect reason code.
+     * @return true if the disconnect is part of a roam in progress and must not be treated as a link loss.
+     */
+    bool onDisconnected(uint8_t reason);
+
+    /**
+     * @brief Handles WIFI_EVENT_STA_BSS_RSSI_LOW by starting the next roaming mechanism.
+     *
+     * @param rssi The RSSI reported by the driver.
+     */
+    void onRssiLow(int32_t rssi);
+
+    /**
+     * @brief Handles WIFI_EVENT_STA_NEIGHBOR_REP by scanning the reported channels.
+     *
+     * @param report Dialog token followed by Neighbor Report elements.
+     * @param len Length of @p report.
+     */
+    void onNeighborReport(const uint8_t* report, size_t len);
+
+    /**
+     * @brief Handles WIFI_EVENT_SCAN_DONE of a roaming scan and roams if a better BSSID was found.
+     *
+     * @return true if the scan belonged to the controller, false otherwise.
+     */
+    bool onScanDone();
+
+    /**
+     * @brief Retrieves a copy of the roaming counters.
+     *
+     * @return Stats Current counters.
+     */
+    Stats getStats() const;
+
+private:
+    /**
+     * @brief Starts a background scan for the current SSID.
+     *
+     * @param channels 2.4 GHz channel bitmap (bit n = channel n), or 0 for all channels.
+     */
+    void startScan(uint16_t channels);
+
+    /**
+     * @brief Reassociates to a BSSID of the current network.
+     *
+     * @param target Scan record of the new access point.
+     */
+    void roamTo(const wifi_ap_record_t& target);
+
+    /**
+     * @brief Records the end of a roam attempt.
+     *
+     * @param success True if the station reassociated.
+     */
+    void finishRoam(bool success);
+
+    /**
+     * @brief Schedules re-arming of the RSSI threshold after @ref Policy::retrigger_ms.
+     */
+    void scheduleRearm();
+
+    /**
+     * @brief esp_timer callback that re-arms the RSSI threshold.
+     *
+     * @param arg Pointer to the RoamingController instance.
+     */
+    static void rearmCallback(void* arg);
+
+    /** @brief Roaming parameters. */
+    Policy m_policy;
+
+    /** @brief True if roaming is enabled. */
+    bool m_enabled;
+
+    /** @brief One-shot timer re-arming the RSSI threshold. */
+    esp_timer_handle_t m_timer;
+
+    /** @brief BSSID of the current association. */
+    uint8_t m_bssid[6];
+
+    /** @brief True while the station is associated. */
+    bool m_associated;
+
+    /** @brief True while a roaming scan is running. */
+    bool m_scanning;
+
+    /** @brief True once a BSS transition query was sent since the last roam. */
+    bool m_btm_tried;
+
+    /** @brief True once a neighbor report was requested since the last roam. */
+    bool m_neighbor_tried;
+
+    /** @brief esp_timer timestamp of the roam decision, or 0 if no roam is in progress. */
+    int64_t m_roam_started_us;
+
+    /** @brief RSSI at the last trigger. */
+    int8_t m_trigger_rssi;
+
+    /** @brief Counters exposed through getStats(). */
+    Stats m_stats;
+
+    /** @brief Guards @ref m_stats against concurrent readers. */
+    mutable portMUX_TYPE m_lock;
+};
@@ -0,0 +1,106 @@
+/**
+ * @file ScanCache.h
+ * @brief Declaration of the ScanCache class holding the most recent scan results.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+
+/**
+ * @class ScanCache
+ * @brief Bounded, de-duplicated table of nearby access points.
+ *
+ * Entries are keyed by BSSID, so repeated scans refresh existing entries instead of adding
+ * duplicates. Entries not seen for SCAN_CACHE_MAX_AGE_MS are dropped. Writers (the event
+ * loop) and readers (the HTTP server) may run concurrently; every access copies under a
+ * spinlock, so readers never see a half-written entry.
+ */
+class ScanCache {
+public:
+    /** @brief Maximum number of cached access points. */
+    static constexpr size_t CAPACITY = SCAN_CACHE_CAPACITY;
+
+    /**
+     * @struct Entry
+     * @brief One cached access point.
+     */
+    struct Entry {
+        /** @brief SSID (null-terminated). */
+        char ssid[33];
+        /** @brief BSSID; the de-duplication key. */
+        uint8_t bssid[6];
+        /** @brief Signal strength in dBm at the last sighting. */
+        int8_t rssi;
+        /** @brief Primary channel. */
+        uint8_t channel;
+        /** @brief Authentication mode. */
+        wifi_auth_mode_t authmode;
+        /** @brief esp_timer timestamp of the last sighting. */
+        int64_t last_seen_us;
+    };
+
+    /**
+     * @brief Constructs an empty ScanCache object.
+     */
+    ScanCache();
+
+    /**
+     * @brief Adds or refreshes one access point from a scan result.
+     *
+     * Hidden networks are skipped. When the cache is full, the weakest entry is replaced if
+     * the new one is stronger.
+     *
+     * @param record The scan result.
+     * @param now_us esp_timer timestamp of the scan.
+     */
+    void add(const wifi_ap_record_t& record, int64_t now_us);
+
+    /**
+     * @brief Adds or refreshes every record of a scan and drops expired entries.
+     *
+     * @param records Scan results.
+     * @param count Number of entries in @p records.
+     */
+    void update(const wifi_ap_record_t* records, size_t count);
+
+    /**
+     * @brief Drops entries not seen for SCAN_CACHE_MAX_AGE_MS.
+     *
+     * @param now_us Current esp_timer timestamp.
+     */
+    void expire(int64_t now_us);
+
+    /**
+     * @brief Copies one entry.
+     *
+     * @param index Entry index, starting at 0.
+     * @param out Output parameter for the entry.
+     * @return true if @p index was valid, false past the last entry.
+     */
+    bool get(size_t index, Entry& out) const;
+
+    /**
+     * @brief Returns the number of cached access points.
+     *
+     * @return size_t Number of entries.
+     */
+    size_t size() const;
+
+private:
+    /**
+     * @brief Removes an entry by moving the last entry into its slot. Lock must be held.
+     *
+     * @param index Index of the entry to remove.
+     */
+    void removeLocked(size_t index);
+
+    /** @brief Cached access points; the first @ref m_count are valid. */
+    Entry m_entries[CAPACITY];
+
+    /** @brief Number of valid entries. */
+    size_t m_count;
+
+    /** @brief Guards @ref m_entries and @ref m_count. */
+    mutable portMUX_TYPE m_lock;
+};
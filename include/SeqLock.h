@@ -0,0 +1,100 @@
+/**
+ * @file SeqLock.h
+ * @brief Declaration of the SeqLock class template for lock-free snapshots of small POD values.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @class SeqLock
+ * @brief Sequence lock publishing a trivially copyable value to lock-free readers.
+ *
+ * The value is stored as an array of atomic words. A writer makes the sequence counter odd,
+ * stores the words and makes it even again; a reader copies the words and retries if the
+ * counter was odd or changed meanwhile. Readers therefore never block and never allocate,
+ * and always see a value written as a whole. Writers are serialized by a spinlock, which
+ * also keeps them from being preempted mid-update on their core.
+ *
+ * @tparam T Trivially copyable value type.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+public:
+    /**
+     * @brief Constructs a SeqLock holding a zero-initialized value.
+     */
+    SeqLock() : m_sequence(0), m_words{}, m_write_lock(portMUX_INITIALIZER_UNLOCKED) {}
+
+    /**
+     * @brief Reads a consistent copy of the value. Lock-free; may be called from any task.
+     *
+     * @param generation Optional output for the number of updates published so far.
+     * @return T Copy of the value.
+     */
+    T read(uint32_t* generation = nullptr) const {
+        uint32_t words[WORDS];
+        uint32_t begin;
+        uint32_t end;
+        do {
+            begin = m_sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            end = m_sequence.load(std::memory_order_relaxed);
+        } while ((begin & 1) != 0 || begin != end);
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        if (generation) *generation = begin / 2;
+        return value;
+    }
+
+    /**
+     * @brief Applies @p update to the value and publishes the result.
+     *
+     * Runs inside a critical section; @p update must be short and must not block or log.
+     *
+     * @param update Callable taking a T& to modify.
+     */
+    template <typename F>
+    void modify(F&& update) {
+        portENTER_CRITICAL(&m_write_lock);
+        uint32_t words[WORDS];
+        for (size_t i = 0; i < WORDS; i++) {
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        memcpy(&value, words, sizeof(T));
+        update(value);
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+        portEXIT_CRITICAL(&m_write_lock);
+    }
+
+private:
+    /** @brief Number of 32-bit words needed to hold a T. */
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    /** @brief Even while stable, odd while an update is in progress. */
+    std::atomic<uint32_t> m_sequence;
+
+    /** @brief Storage of the value. */
+    std::atomic<uint32_t> m_words[WORDS];
+
+    /** @brief Serializes writers. */
+    portMUX_TYPE m_write_lock;
+};
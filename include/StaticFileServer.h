@@ -0,0 +1,82 @@
+/**
+ * @file StaticFileServer.h
+ * @brief Declaration of the StaticFileServer class serving files from the LittleFS partition.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "config.h"
+#include "LazyFileSystem.h"
+#include "FileStreamer.h"
+
+/**
+ * @class StaticFileServer
+ * @brief Serves files below STATIC_FILES_DIR of the LittleFS partition.
+ *
+ * Request paths are checked before they reach the VFS: only plain characters are accepted and
+ * no segment may start with a dot, so ".." and hidden files cannot be reached. The content
+ * type comes from a compile-time table of extensions. If the client accepts gzip and a ".gz"
+ * sibling exists, the sibling is sent with Content-Encoding: gzip. Each response carries an
+ * ETag built from the size and modification time of the file actually sent, with
+ * ASSET_CACHE_CONTROL; a matching If-None-Match is answered with 304 Not Modified. A single
+ * "bytes" Range is honoured with 206 Partial Content (on the representation actually sent),
+ * so large files can be resumed, unless an If-Range no longer matches the ETag; several
+ * ranges are answered with the full file. Bodies are sent by a FileStreamer with their
+ * Content-Length.
+ */
+class StaticFileServer {
+public:
+    /**
+     * @brief Constructs a StaticFileServer object.
+     *
+     * @param fs Filesystem to serve from; mounted on first use.
+     * @param streamer Sends the file bodies; must outlive the server.
+     */
+    StaticFileServer(LazyFileSystem& fs, FileStreamer& streamer);
+
+    /**
+     * @brief Sends a file as the complete response.
+     *
+     * @param req HTTP request handle.
+     * @param path Path relative to STATIC_FILES_DIR, starting with '/'; a query string is ignored.
+     * @return esp_err_t ESP_OK if a response was sent, ESP_ERR_NOT_FOUND if the path is invalid
+     *         or the file does not exist (nothing has been sent in that case), error code otherwise.
+     */
+    esp_err_t serve(httpd_req_t* req, const char* path);
+
+    /**
+     * @brief Returns the content type for a file name.
+     *
+     * @param path File name or path.
+     * @return const char* Content type; "application/octet-stream" for unknown extensions.
+     */
+    static const char* mimeType(const char* path);
+
+private:
+    /**
+     * @brief Checks a request path and builds the file path on the partition.
+     *
+     * @param path Request path relative to STATIC_FILES_DIR.
+     * @param out Output buffer for the file path.
+     * @param size Capacity of @p out.
+     * @return true if the path is safe and fits.
+     */
+    static bool resolve(const char* path, char* out, size_t size);
+
+    /**
+     * @brief Parses a single-range "bytes=" Range header against a file size.
+     *
+     * @param value Header value.
+     * @param size File size in bytes.
+     * @param start Output first byte offset.
+     * @param end Output last byte offset (inclusive).
+     * @return int 1 if the range is satisfiable, 0 if the header should be ignored, -1 if it is unsatisfiable.
+     */
+    static int parseRange(const char* value, size_t size, size_t* start, size_t* end);
+
+    /** @brief Filesystem to serve from. */
+    LazyFileSystem& m_fs;
+
+    /** @brief Sends the file bodies. */
+    FileStreamer& m_streamer;
+};
@@ -5,6 +5,22 @@
 
 #pragma once
 #include "sdk_compat.h"
+#include "ReconnectScheduler.h"
+#include "CredentialStore.h"
+#include "ConnectionStateMachine.h"
+#include "ScanCache.h"
+#include "RoamingController.h"
+#include "ConnectionTimingLog.h"
+#include "SeqLock.h"
+#include "LinkEventPublisher.h"
+#include "CaptiveDnsServer.h"
+#include "ProvisioningClientTracker.h"
+#include "LazyFileSystem.h"
+#include "AssetCache.h"
+#include "FileStreamer.h"
+#include "StaticFileServer.h"
+#include "FlashAssetStore.h"
+#include <atomic>
 
 /**
  * @class WifiManager
@@ -12,12 +28,59 @@
  */
 class WifiManager {
 public:
+    /** @brief IP addressing mode of a stored network. */
+    using IpMode = CredentialStore::IpMode;
+
+    /** @brief IPv4 configuration of a stored network. */
+    using IpSettings = CredentialStore::IpSettings;
+
+    /** @brief State of the connection lifecycle. */
+    using ConnectionState = ConnectionStateMachine::State;
+
+    /** @brief Callback invoked from the connection task after every state transition. */
+    using StateCallback = std::function<void(ConnectionState)>;
+
+    /**
+     * @struct LinkStatus
+     * @brief Consistent snapshot of the connection, published through a SeqLock.
+     */
+    struct LinkStatus {
+        /** @brief State of the connection lifecycle. */
+        ConnectionState state;
+        /** @brief True while the station is associated and has an IP address. */
+        bool connected;
+        /** @brief RSSI in dBm at the last update (association, GOT_IP or low-RSSI event). */
+        int8_t rssi;
+        /** @brief Channel of the current association. */
+        uint8_t channel;
+        /** @brief BSSID of the current association. */
+        uint8_t bssid[6];
+        /** @brief Station IP address, 0 if none. */
+        esp_ip4_addr_t ip;
+        /** @brief Number of updates published so far; changes whenever any field changes. */
+        uint32_t generation;
+    };
+
+    /**
+     * @brief Outcome of validating credentials submitted in provisioning mode.
+     */
+    enum class ValidationResult : uint8_t {
+        Pending,        /**< No outcome yet. */
+        Success,        /**< Associated and obtained an IP; the network was stored. */
+        WrongPassword,  /**< The AP rejected the passphrase. */
+        SsidNotFound,   /**< No AP with the SSID was found. */
+        DhcpTimeout,    /**< Associated, but no IP was obtained in time. */
+        Failed          /**< Any other failure. */
+    };
+
     /**
      * @brief Constructs a new WifiManager object.
      *
      * Initializes the event group for Wi-Fi event handling.
+     *
+     * @param fs Filesystem holding the provisioning page; mounted on first use, must outlive the manager.
      */
-    WifiManager();
+    explicit WifiManager(LazyFileSystem& fs);
 
     /**
      * @brief Destroys the WifiManager object.
@@ -26,66 +89,419 @@ public:
      */
     ~WifiManager();
 
+    /**
+     * @brief Initializes the TCP/IP stack, the default event loop and both default netifs.
+     *
+     * Independent of NVS; may run concurrently with other boot stages. Called by start() if
+     * it has not been called before.
+     */
+    void initNetwork();
+
+    /**
+     * @brief Initializes the Wi-Fi driver and registers the event handlers.
+     *
+     * Requires initNetwork() and an initialized NVS partition. Called by start() if it has
+     * not been called before.
+     */
+    void initDriver();
+
     /**
      * @brief Starts the Wi-Fi management process.
      *
-     * Attempts to connect using stored credentials. If connection fails or no credentials are available,
-     * it switches to provisioning mode (AP).
+     * Returns immediately. A dedicated task connects using stored credentials and, if that
+     * fails or no credentials are available, switches to provisioning mode (AP), where submitted
+     * credentials are validated live before they are stored. Progress is
+     * reported through the state callback and waitForConnection().
      */
     void start();
 
     /**
-     * @brief Checks if the device is currently connected to Wi-Fi in Station mode.
+     * @brief Registers a callback for state transitions. Must be called before start().
+     *
+     * @param callback Callback invoked from the connection task with the new state.
+     */
+    void setStateCallback(StateCallback callback);
+
+    /**
+     * @brief Returns the current state of the connection lifecycle. Lock-free.
+     *
+     * @return ConnectionState The current state.
+     */
+    ConnectionState getState() const;
+
+    /**
+     * @brief Returns a consistent snapshot of state, IP, RSSI and BSSID. Lock-free, no allocation.
+     *
+     * @return LinkStatus The snapshot.
+     */
+    LinkStatus getLinkStatus() const;
+
+    /**
+     * @brief Blocks until the device is connected or has entered provisioning mode.
+     *
+     * @param timeout Maximum time to wait, in ticks.
+     * @return ConnectionState The state at the time the wait ended.
+     */
+    ConnectionState waitForConnection(TickType_t timeout);
+
+    /**
+     * @brief Checks if the device is currently connected to Wi-Fi in Station mode. Lock-free.
      *
      * @return true if connected, false otherwise.
      */
     bool isConnected() const;
 
     /**
-     * @brief Retrieves the current IP address of the device in Station mode.
+     * @brief Retrieves the current IP address of the device in Station mode. Lock-free.
+     *
+     * @return esp_ip4_addr_t The address, 0 if not connected.
+     */
+    esp_ip4_addr_t getIpAddress() const;
+
+    /**
+     * @brief Retrieves the reconnection counters, e.g. how many attempts the last recovery took.
      *
-     * @return std::string containing the IP address, or an empty string if not connected.
+     * @return ReconnectScheduler::Stats Copy of the current counters.
      */
-    std::string getIpAddress() const;
+    ReconnectScheduler::Stats getReconnectStats() const;
+
+    /**
+     * @brief Enables roaming between access points of the connected network. Must be called before start().
+     *
+     * @param enabled True to enable roaming (see RoamingController).
+     */
+    void setRoamingEnabled(bool enabled);
+
+    /**
+     * @brief Enables or disables the station-mode control server (/reset, /status).
+     *
+     * The server is started right away if the station has an IP, otherwise on the next
+     * GotIP; disabling it stops it. The provisioning server is not affected.
+     * Initially STA_CONTROL_SERVER_ENABLED.
+     *
+     * @param enabled True to serve the control endpoints while connected.
+     */
+    void setControlServerEnabled(bool enabled);
+
+    /**
+     * @brief Retrieves the roaming counters, e.g. the duration of the last roam.
+     *
+     * @return RoamingController::Stats Copy of the current counters.
+     */
+    RoamingController::Stats getRoamingStats() const;
+
+    /**
+     * @brief Copies the phase timings of the last connection attempts, newest first.
+     *
+     * @param out Output array; CONNECTION_TIMING_HISTORY entries hold the full history.
+     * @param max Capacity of @p out.
+     * @return size_t Number of records written.
+     */
+    size_t getConnectionTimings(ConnectionTimingLog::Record* out, size_t max) const;
+
+    /**
+     * @brief Subscribes a queue to connectivity changes (up, down, IP changed, roamed).
+     *
+     * Events are posted from the Wi-Fi event loop without blocking; a full queue drops the event.
+     *
+     * @param queue Queue created with an item size of sizeof(LinkEventPublisher::LinkEvent).
+     * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if LINK_EVENT_MAX_SUBSCRIBERS are subscribed.
+     */
+    esp_err_t subscribe(QueueHandle_t queue);
+
+    /**
+     * @brief Removes a queue added with subscribe().
+     *
+     * @param queue The queue.
+     */
+    void unsubscribe(QueueHandle_t queue);
+
+    /**
+     * @brief Drops the in-memory copy of the web assets; call after updating the storage partition.
+     */
+    void invalidateAssetCache();
 
 private:
     /**
-     * @brief Initializes the TCP/IP stack and default event loop.
+     * @struct FastConnectRecord
+     * @brief Last known good AP parameters, persisted in NVS to skip the scan and PSK derivation on boot.
+     */
+    struct FastConnectRecord {
+        /** @brief SSID the record belongs to (null-terminated). */
+        char ssid[33];
+        /** @brief BSSID of the AP the device last obtained an IP from. */
+        uint8_t bssid[6];
+        /** @brief Primary channel of that AP. */
+        uint8_t channel;
+        /** @brief wifi_auth_mode_t of that AP; also the minimum accepted on the directed connect. */
+        uint8_t authmode;
+        /** @brief Non-zero if @ref pmk holds a derived PMK; only for WPA/WPA2-PSK, zero for open and SAE networks. */
+        uint8_t pmk_valid;
+        /** @brief WPA2 Pairwise Master Key derived from SSID and passphrase. */
+        uint8_t pmk[32];
+    };
+
+    /** @brief Event of the connection state machine. */
+    using ConnectionEvent = ConnectionStateMachine::Event;
+
+    /**
+     * @brief Entry point of the connection task.
+     *
+     * @param arg Pointer to the WifiManager instance.
+     */
+    static void connectionTask(void* arg);
+
+    /**
+     * @brief Processes connection events for the lifetime of the manager.
      */
-    void initialize();
+    void runConnectionLoop();
+
+    /**
+     * @brief Applies an event to the state machine and runs the entry action of the new state.
+     *
+     * @param event The event to apply.
+     */
+    void handleEvent(ConnectionEvent event);
+
+    /**
+     * @brief Runs the entry action of a state.
+     *
+     * @param state The state just entered.
+     * @param cause The event that caused the transition.
+     * @param follow_up Output parameter for an event produced by the entry action.
+     * @return true if @p follow_up was set, false otherwise.
+     */
+    bool enterState(ConnectionState state, ConnectionEvent cause, ConnectionEvent& follow_up);
+
+    /**
+     * @brief Picks the event describing a failed attempt: next candidate, rescan or give up.
+     *
+     * @return ConnectionEvent The resolved event.
+     */
+    ConnectionEvent resolveFailedAttempt();
+
+    /**
+     * @brief Starts a directed connect to the next scanned candidate.
+     */
+    void connectToNextCandidate();
+
+    /**
+     * @brief Hands credentials from the provisioning page to the connection task for validation.
+     *
+     * @param network The submitted network.
+     * @return true if the attempt was queued, false if another validation is in progress.
+     */
+    bool requestValidation(const CredentialStore::Network& network);
+
+    /**
+     * @brief Starts a fail-fast connect with the credentials under validation, keeping the AP up.
+     */
+    void startValidation();
+
+    /**
+     * @brief Stores the validated network and makes it the active one.
+     */
+    void acceptValidatedNetwork();
+
+    /**
+     * @brief Publishes @ref m_validation_result to the status endpoint polled by the provisioning page.
+     */
+    void completeValidation();
+
+    /**
+     * @brief Shuts down the provisioning AP and web server, keeping the station link.
+     *
+     * Runs on the connection task, on ConnectionEvent::HandoffDue: shortly after the page
+     * fetched the result, or PROV_HANDOFF_TIMEOUT_MS after the validation succeeded.
+     */
+    void leaveProvisioning();
+
+    /**
+     * @brief esp_timer callback; queues ConnectionEvent::HandoffDue.
+     *
+     * @param arg Pointer to the WifiManager instance.
+     */
+    static void onHandoffDue(void* arg);
+
+    /**
+     * @brief Queues an event for the connection task.
+     *
+     * @param event The event to queue.
+     */
+    void postEvent(ConnectionEvent event);
+
+    /**
+     * @brief Publishes a connectivity change built from the current link snapshot.
+     *
+     * @param type Kind of change.
+     * @param reason Disconnect reason for LinkEventPublisher::Type::Down, 0 otherwise.
+     */
+    void publishLinkEvent(LinkEventPublisher::Type type, uint8_t reason = 0);
+
+    /**
+     * @brief ReconnectScheduler callback; queues ConnectionEvent::RetryDue.
+     *
+     * @param arg Pointer to the WifiManager instance.
+     */
+    static void onRetryDue(void* arg);
+
+    /**
+     * @brief Runs one scan and ranks the stored networks found in it.
+     *
+     * @param candidates Output array, sorted by descending score.
+     * @param max Capacity of @p candidates.
+     * @return size_t Number of candidates written.
+     */
+    size_t scanForKnownNetworks(CredentialStore::Candidate* candidates, size_t max);
+
+    /**
+     * @brief Starts a non-blocking scan that refreshes @ref m_scan_cache.
+     */
+    void startBackgroundScan();
+
+    /**
+     * @brief Moves the results of a finished background scan into @ref m_scan_cache.
+     */
+    void collectBackgroundScan();
+
+    /**
+     * @brief Makes a stored network the active one and loads its IP configuration.
+     *
+     * @param index Index of the network in the credential store.
+     */
+    void selectNetwork(size_t index);
 
     /**
      * @brief Attempts to connect to a Wi-Fi Access Point with the provided credentials.
      *
      * @param ssid The SSID of the Wi-Fi network.
      * @param password The password of the Wi-Fi network.
+     * @param target Optional BSSID/channel (and PMK) to connect to; when given, the driver
+     *               performs a directed, single-channel connect.
+     * @param fail_fast If true, the first disconnect fails the attempt instead of retrying.
      * @return esp_err_t ESP_OK if connection attempt is successful, ESP_FAIL otherwise.
      */
-    esp_err_t connectToWifi(const std::string& ssid, const std::string& password);
+    esp_err_t connectToWifi(const std::string& ssid, const std::string& password,
+                            const FastConnectRecord* target = nullptr, bool fail_fast = false);
+
+    /**
+     * @brief Drops a BSSID and channel pinned by a directed connect, so the next attempt scans all channels.
+     */
+    void unpinStation();
+
+    /**
+     * @brief Applies the configured IP mode to the station interface before association.
+     *
+     * @param netif The station network interface.
+     */
+    void applyIpMode(esp_netif_t* netif);
+
+    /**
+     * @brief Handles ConnectionEvent::AddressAssigned: persists a DHCP lease or starts verifying a reused one.
+     */
+    void onAddressAssigned();
+
+    /**
+     * @brief Sends the next ARP probe for a reused lease and evaluates the previous one.
+     *
+     * Runs on the connection task, on ConnectionEvent::LeaseCheckDue.
+     */
+    void verifyLease();
+
+    /**
+     * @brief esp_timer callback; queues ConnectionEvent::LeaseCheckDue.
+     *
+     * @param arg Pointer to the WifiManager instance.
+     */
+    static void onLeaseCheckDue(void* arg);
+
+    /**
+     * @brief Hands the station interface to the DHCP client once the reused lease has expired.
+     *
+     * Runs on the connection task, on ConnectionEvent::LeaseExpired.
+     */
+    void expireLease();
+
+    /**
+     * @brief esp_timer callback; queues ConnectionEvent::LeaseExpired.
+     *
+     * @param arg Pointer to the WifiManager instance.
+     */
+    static void onLeaseExpiryDue(void* arg);
+
+    /**
+     * @brief httpd open hook of the provisioning server; registers the session with its station.
+     *
+     * @param handle Server handle.
+     * @param sockfd Socket of the new session.
+     * @return esp_err_t ESP_OK to accept the session, ESP_FAIL to close it.
+     */
+    static esp_err_t onSessionOpen(httpd_handle_t handle, int sockfd);
+
+    /**
+     * @brief httpd close hook of the provisioning server; unregisters and closes the session.
+     *
+     * @param handle Server handle.
+     * @param sockfd Socket of the session.
+     */
+    static void onSessionClose(httpd_handle_t handle, int sockfd);
+
+    /**
+     * @brief esp_timer callback closing provisioning sessions that have been idle too long.
+     *
+     * @param arg Pointer to the WifiManager instance.
+     */
+    static void idleSessionCheck(void* arg);
+
+    /**
+     * @brief Charges a request to its station's budget; answers 429 if the budget is exhausted.
+     *
+     * @param req HTTP request handle.
+     * @return true if the handler may serve the request, false if it has been answered already.
+     */
+    bool admitRequest(httpd_req_t* req);
 
     /**
      * @brief Starts Access Point mode for provisioning.
      *
-     * Runs a simple web server to receive new Wi-Fi credentials.
+     * Runs a simple web server to receive and validate new Wi-Fi credentials.
      */
     void startProvisioning();
 
     /**
-     * @brief Stops Wi-Fi in AP and/or STA mode.
+     * @brief Scans all channels and returns the least congested of channels 1, 6 and 11.
+     *
+     * The scan results also refresh @ref m_scan_cache. Requires the station interface.
+     *
+     * @return uint8_t The channel for the provisioning AP.
+     */
+    uint8_t selectProvisioningChannel();
+
+    /**
+     * @brief Switches the Wi-Fi driver to the given mode without deinitializing it.
+     *
+     * @param mode The target Wi-Fi mode.
+     * @param keep_station If true, an existing station association is kept.
+     * @param ap_config Optional SoftAP configuration, applied before the driver is started.
      */
-    void stopWifi();
+    void switchMode(wifi_mode_t mode, bool keep_station = false, const wifi_config_t* ap_config = nullptr);
 
     /**
      * @brief Starts the HTTP web server.
      *
-     * @param is_provisioning_mode True if the server is for AP provisioning mode, false for STA mode (reset endpoint only).
+     * A running control server is replaced by the provisioning server; a running
+     * provisioning server is left alone.
+     *
+     * @param is_provisioning_mode True if the server is for AP provisioning mode, false for the STA control server.
      */
     void startWebServer(bool is_provisioning_mode);
 
     /**
      * @brief Stops the HTTP web server.
+     *
+     * @param control_only True to stop the server only if it is the station-mode control server.
      */
-    void stopWebServer();
+    void stopWebServer(bool control_only = false);
 
     /**
      * @brief Static event handler for Wi-Fi events.
@@ -105,14 +521,43 @@ private:
      */
     static esp_err_t provisioningGetHandler(httpd_req_t *req);
 
+    /**
+     * @brief Records and logs the serve time of the provisioning page.
+     *
+     * @param source Where the page came from ("flash", "cache" or "LittleFS").
+     * @param start_us esp_timer timestamp at which the request was accepted.
+     * @param total_bytes Body bytes sent from this source so far.
+     * @param total_us Time spent sending them, or 0 if not measured.
+     */
+    void logServe(const char* source, int64_t start_us, uint32_t total_bytes, uint64_t total_us);
+
     /**
      * @brief HTTP POST handler for receiving Wi-Fi credentials.
      *
+     * Queues the credentials for validation and answers 202 at once; the outcome is
+     * fetched from connectStatusGetHandler().
+     *
      * @param req HTTP request handle.
      * @return esp_err_t ESP_OK on success, error code otherwise.
      */
     static esp_err_t connectPostHandler(httpd_req_t *req);
 
+    /**
+     * @brief HTTP GET handler reporting the outcome of the last submitted credentials as JSON.
+     *
+     * @param req HTTP request handle.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    static esp_err_t connectStatusGetHandler(httpd_req_t *req);
+
+    /**
+     * @brief HTTP GET handler streaming the scan cache as a JSON array.
+     *
+     * @param req HTTP request handle.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    static esp_err_t scanGetHandler(httpd_req_t *req);
+
     /**
      * @brief HTTP GET handler for reset endpoint.
      *
@@ -121,6 +566,14 @@ private:
      */
     static esp_err_t resetGetHandler(httpd_req_t* req);
 
+    /**
+     * @brief HTTP GET handler reporting the connection state and phase timings as JSON.
+     *
+     * @param req HTTP request handle.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    static esp_err_t statusGetHandler(httpd_req_t* req);
+
     /**
      * @brief HTTP GET handler for favicon.
      *
@@ -130,43 +583,276 @@ private:
     static esp_err_t faviconGetHandler(httpd_req_t *req);
 
     /**
-     * @brief Saves Wi-Fi credentials to Non-Volatile Storage (NVS).
+     * @brief HTTP GET handler for the /static/ wildcard, serving files below STATIC_FILES_DIR.
      *
-     * @param ssid The SSID to save.
-     * @param password The password to save.
+     * @param req HTTP request handle.
      * @return esp_err_t ESP_OK on success, error code otherwise.
      */
-    esp_err_t saveCredentials(const std::string& ssid, const std::string& password);
+    static esp_err_t staticGetHandler(httpd_req_t* req);
 
     /**
-     * @brief Loads Wi-Fi credentials from Non-Volatile Storage (NVS).
+     * @brief HTTP GET handler for OS connectivity probes; redirects to the provisioning page.
      *
-     * @param ssid Output parameter for the loaded SSID.
-     * @param password Output parameter for the loaded password.
+     * @param req HTTP request handle.
      * @return esp_err_t ESP_OK on success, error code otherwise.
      */
-    esp_err_t loadCredentials(std::string& ssid, std::string& password);
+    static esp_err_t captivePortalRedirectHandler(httpd_req_t* req);
+
+    /**
+     * @brief HTTP 404 handler in provisioning mode; redirects unknown URIs to the provisioning page.
+     *
+     * @param req HTTP request handle.
+     * @param error The error code (HTTPD_404_NOT_FOUND).
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    static esp_err_t notFoundRedirectHandler(httpd_req_t* req, httpd_err_code_t error);
+
+    /**
+     * @brief Servers a route is registered on, combined as a bit mask.
+     */
+    enum RouteMode : uint8_t {
+        ROUTE_PROVISIONING = 1 << 0,                     /**< Provisioning server on the AP. */
+        ROUTE_STATION = 1 << 1,                          /**< Control server on the STA interface. */
+        ROUTE_BOTH = ROUTE_PROVISIONING | ROUTE_STATION  /**< Both servers. */
+    };
+
+    /**
+     * @struct Route
+     * @brief One URI handler of the web server.
+     */
+    struct Route {
+        /** @brief URI, matched with httpd_uri_match_wildcard(). */
+        const char* uri;
+        /** @brief HTTP method. */
+        httpd_method_t method;
+        /** @brief Handler; receives the WifiManager instance as user context. */
+        esp_err_t (*handler)(httpd_req_t* req);
+        /** @brief RouteMode bits of the servers the route is registered on. */
+        uint8_t modes;
+    };
+
+    /** @brief All routes of the web server, registered in order by startWebServer(). */
+    static const Route ROUTES[];
+
+    /**
+     * @brief Counts the routes registered on a server.
+     *
+     * @param mode ROUTE_PROVISIONING or ROUTE_STATION.
+     * @return size_t Number of entries of ROUTES with @p mode set.
+     */
+    static constexpr size_t routeCount(uint8_t mode);
+
+    /**
+     * @brief Persists an address obtained via DHCP as the active network's last lease if it changed.
+     *
+     * Writes NVS, so it runs on the connection task only.
+     *
+     * @param netif The station network interface.
+     * @param ip_info The address of the interface.
+     */
+    void saveLease(esp_netif_t* netif, const esp_netif_ip_info_t& ip_info);
+
+    /**
+     * @brief Loads the fast-connect record from NVS.
+     *
+     * @param record Output parameter for the loaded record.
+     * @return esp_err_t ESP_OK on success, error code if no valid record exists.
+     */
+    esp_err_t loadFastConnectRecord(FastConnectRecord& record);
+
+    /**
+     * @brief Builds a fast-connect record from the current association and saves it to NVS.
+     *
+     * The PMK is derived only if the AP uses WPA/WPA2-PSK; SAE derives its keys per
+     * association from the passphrase, so a cached PMK cannot be replayed there.
+     *
+     * @param ssid The SSID of the connected network.
+     * @param password The passphrase used to derive the PMK.
+     * @return esp_err_t ESP_OK on success, error code otherwise.
+     */
+    esp_err_t saveFastConnectRecord(const std::string& ssid, const std::string& password);
+
+    /**
+     * @brief Removes the fast-connect record from NVS.
+     */
+    void clearFastConnectRecord();
 
     /**
      * @brief Clears stored credentials and restarts the device.
      */
     void clearCredentialsAndRestart();
 
-    /** @brief Event group handle for managing Wi-Fi connection events (connected/failed). */
+    /** @brief Event group handle signaling the terminal outcomes (connected/provisioning/validated). */
     EventGroupHandle_t m_wifi_event_group;
 
+    /** @brief Queue of ConnectionEvent values consumed by the connection task. */
+    QueueHandle_t m_event_queue;
+
+    /** @brief Handle of the connection task. */
+    TaskHandle_t m_task;
+
+    /** @brief Transition logic of the connection lifecycle. */
+    ConnectionStateMachine m_state_machine;
+
+    /** @brief Callback invoked after every state transition. */
+    StateCallback m_state_callback;
+
+    /** @brief Stored networks found by the last scan, in ranking order. */
+    CredentialStore::Candidate m_candidates[CredentialStore::CAPACITY];
+
+    /** @brief Number of entries in @ref m_candidates. */
+    size_t m_candidate_count;
+
+    /** @brief Index of the next candidate to try. */
+    size_t m_next_candidate;
+
     /** @brief Handle for the HTTP web server. */
     httpd_handle_t m_server;
 
-    /** @brief Current connection status. */
-    bool m_is_connected;
+    /** @brief True if @ref m_server is the provisioning server. */
+    bool m_server_provisioning;
+
+    /** @brief Serializes starting and stopping the web server between the connection task and callers. */
+    SemaphoreHandle_t m_server_mutex;
+
+    /** @brief True if the control server runs while the station has an IP. */
+    std::atomic<bool> m_control_server_enabled;
+
+    /** @brief Filesystem holding the provisioning page. */
+    LazyFileSystem& m_fs;
+
+    /** @brief In-memory copy of the provisioning page. */
+    AssetCache m_assets;
+
+    /** @brief Streams file responses from LittleFS through one lazily allocated buffer. */
+    FileStreamer m_streamer;
+
+    /** @brief Serves the /static/ wildcard and the favicon from the partition. */
+    StaticFileServer m_static;
+
+    /** @brief Assets served straight from the memory-mapped asset partition. */
+    FlashAssetStore m_flash_assets;
+
+    /** @brief Body bytes of the provisioning page streamed from LittleFS; only touched by the httpd task. */
+    uint32_t m_littlefs_bytes_sent;
+
+    /** @brief Time spent streaming the provisioning page from LittleFS, in microseconds. */
+    uint64_t m_littlefs_serve_us;
+
+    /** @brief Resolves every name to the AP address while provisioning. */
+    CaptiveDnsServer m_dns;
+
+    /** @brief URL of the provisioning page ("http://<AP address>/"), target of captive-portal redirects. */
+    char m_portal_url[32];
+
+    /** @brief Connection snapshot written by the event loop and connection task, read by anyone. */
+    SeqLock<LinkStatus> m_link;
+
+    /** @brief Subscriber queues notified of connectivity changes. */
+    LinkEventPublisher m_link_events;
+
+    /** @brief Table of known networks. */
+    CredentialStore m_credentials;
+
+    /** @brief Index of the network currently in use, or -1. */
+    int m_active_network;
+
+    /** @brief Nearby access points, refreshed in the background while provisioning. */
+    ScanCache m_scan_cache;
+
+    /** @brief True while a background scan started by startBackgroundScan() is running. Cleared by the event loop. */
+    std::atomic<bool> m_background_scan;
+
+    /** @brief Default station netif, created once in initialize(). */
+    esp_netif_t* m_sta_netif;
+
+    /** @brief Default access point netif, created once in initialize(). */
+    esp_netif_t* m_ap_netif;
+
+    /** @brief True once esp_wifi_start() has been called. */
+    bool m_wifi_started;
+
+    /** @brief True once initNetwork() has run. */
+    bool m_network_ready;
+
+    /** @brief True once initDriver() has run. */
+    bool m_driver_ready;
+
+    /** @brief Set before a locally initiated disconnect so its ASSOC_LEAVE event is not treated as a failure. Cleared by the event loop. */
+    std::atomic<bool> m_local_disconnect;
+
+    /** @brief Backoff scheduler for reconnection attempts after a disconnect. */
+    ReconnectScheduler m_reconnect;
+
+    /** @brief Moves the station to a stronger BSSID of the same network when enabled. */
+    RoamingController m_roaming;
+
+    /** @brief Phase timings of the last connection attempts. */
+    ConnectionTimingLog m_timings;
+
+    /** @brief True while the pending attempt fails on its first disconnect (no retries); test-and-cleared by whoever handles the failure. */
+    std::atomic<bool> m_fast_connect_active;
+
+    /** @brief True between WIFI_EVENT_STA_CONNECTED and the next disconnect. Written by the event loop. */
+    std::atomic<bool> m_sta_associated;
+
+    /** @brief True while credentials submitted in provisioning mode are being tried. Set by the HTTP server task. */
+    std::atomic<bool> m_validating;
+
+    /** @brief Network under validation; stored only once it obtains an IP. */
+    CredentialStore::Network m_pending_network;
+
+    /** @brief Outcome of the current or last validation. */
+    std::atomic<ValidationResult> m_validation_result;
+
+    /** @brief esp_timer timestamp at which the pending connection attempt was started. */
+    std::atomic<int64_t> m_connect_start_us;
+
+    /** @brief Time from connection start to IP_EVENT_STA_GOT_IP of the last successful attempt. */
+    std::atomic<int64_t> m_time_to_ip_us;
+
+    /** @brief IP addressing mode of the active network. */
+    IpMode m_ip_mode;
+
+    /** @brief Static configuration used in IpMode::Static. */
+    IpSettings m_static_ip;
+
+    /** @brief Last DHCP lease of the active network, reused in IpMode::ReuseLease. */
+    IpSettings m_lease;
+
+    /** @brief True if @ref m_lease holds a stored lease. */
+    bool m_lease_valid;
+
+    /** @brief time() in seconds when @ref m_lease was granted; 0 if unknown. */
+    int64_t m_lease_granted;
+
+    /** @brief Duration of @ref m_lease in seconds; 0 if unknown, UINT32_MAX for infinite. */
+    uint32_t m_lease_seconds;
+
+    /** @brief True while the cached lease is configured statically and awaiting an address event. Connection task only. */
+    bool m_lease_applied;
+
+    /** @brief True while ARP probes confirm the reused lease. Connection task only. */
+    bool m_lease_verifying;
+
+    /** @brief ARP probes sent for the reused lease so far. */
+    uint8_t m_lease_probes;
+
+    /** @brief One-shot timer spacing the ARP probes of a reused lease. */
+    esp_timer_handle_t m_lease_verify_timer;
+
+    /** @brief One-shot timer firing when the reused lease expires. */
+    esp_timer_handle_t m_lease_expiry_timer;
+
+    /** @brief Sessions, request budgets and serve latencies of the provisioning server. */
+    ProvisioningClientTracker m_clients;
 
-    /** @brief Number of reconnection attempts. */
-    uint8_t m_retry_num;
+    /** @brief Periodic timer closing idle provisioning sessions. */
+    esp_timer_handle_t m_idle_session_timer;
 
-    /** @brief Current IP address in Station mode. */
-    std::string m_current_ip;
+    /** @brief One-shot timer delaying the AP shutdown after a successful validation. */
+    esp_timer_handle_t m_handoff_timer;
 
-    /** @brief Maximum number of reconnection attempts before giving up. */
-    static constexpr uint8_t MAX_RETRY = 5;
+    /** @brief True from a successful validation until a GET /connect has delivered the result. */
+    std::atomic<bool> m_handoff_pending;
 };
\ No newline at end of file
@@ -17,8 +17,103 @@
 /** @brief Password for the provisioning Access Point (minimum 8 characters). */
 #define PROV_AP_PASS "password123"
 
-/** @brief Maximum number of clients that can connect to the Access Point. */
-#define PROV_AP_MAX_CONN 1
+/** @brief Maximum number of clients that can connect to the Access Point (e.g. a technician's phone and laptop). */
+#define PROV_AP_MAX_CONN 4
+
+/** @brief Time allowed for submitted credentials to associate and obtain an IP before validation fails. */
+#define PROV_VALIDATION_TIMEOUT_MS 15000
+
+/** @brief Delay between the page fetching a successful result from GET /connect and shutting down the provisioning AP, so the response leaves the socket. */
+#define PROV_HANDOFF_DELAY_MS 1000
+
+/**
+ * @brief Time the provisioning AP stays up after a successful validation if no page fetches the result.
+ *
+ * In APSTA mode the SoftAP follows the station to its channel, so clients drop during
+ * validation and phones can take several seconds to rejoin; the AP waits for them.
+ */
+#define PROV_HANDOFF_TIMEOUT_MS 60000
+
+/** @brief If 1, the provisioning AP starts on the least congested of channels 1, 6 and 11; if 0, on PROV_AP_DEFAULT_CHANNEL. */
+#define PROV_AP_AUTO_CHANNEL 1
+
+/** @brief Channel of the provisioning AP when automatic selection is disabled or its scan fails. */
+#define PROV_AP_DEFAULT_CHANNEL 1
+
+/** @brief Maximum number of scan records weighed when choosing the provisioning AP channel. */
+#define PROV_CHANNEL_SCAN_MAX_RECORDS 32
+
+/** @brief Congestion added by every overlapping AP on top of its signal strength. */
+#define PROV_CHANNEL_AP_WEIGHT 20
+
+/** @} */
+
+/**
+ * @defgroup ProvisioningClientConfig Provisioning Client Limits
+ * @brief Socket limits, idle eviction and request budgets for clients of the provisioning AP.
+ * @{
+ */
+
+/** @brief HTTP sockets allowed per AP client (browsers open more than one connection). */
+#define PROV_HTTPD_SOCKETS_PER_CLIENT 2
+
+/** @brief Open HTTP sockets while provisioning; with the httpd internals and the DNS socket this must fit CONFIG_LWIP_MAX_SOCKETS. */
+#define PROV_HTTPD_MAX_SOCKETS (PROV_AP_MAX_CONN * PROV_HTTPD_SOCKETS_PER_CLIENT)
+
+/** @brief Send/receive timeout of the HTTP server while provisioning, in seconds. */
+#define PROV_HTTPD_IO_TIMEOUT_S 5
+
+/** @brief Time after which the AP deauthenticates a station it has not heard from, in seconds. */
+#define PROV_AP_INACTIVE_TIME_S 60
+
+/** @brief HTTP sessions without a request for this long are closed. */
+#define PROV_CLIENT_IDLE_TIMEOUT_MS 20000
+
+/** @brief Interval of the idle-session check. */
+#define PROV_CLIENT_IDLE_CHECK_MS 5000
+
+/** @brief Requests a single station may make per budget window before it is answered with 429. */
+#define PROV_CLIENT_REQUEST_BUDGET 40
+
+/** @brief Length of the per-station request budget window. */
+#define PROV_CLIENT_BUDGET_WINDOW_MS 10000
+
+/** @} */
+
+/**
+ * @defgroup CaptivePortalConfig Captive Portal Configuration
+ * @brief DNS responder answering every query with the provisioning AP address.
+ * @{
+ */
+
+/** @brief Stack size of the DNS responder task. */
+#define DNS_SERVER_TASK_STACK_SIZE 3072
+
+/** @brief Priority of the DNS responder task. */
+#define DNS_SERVER_TASK_PRIORITY 4
+
+/** @brief Receive timeout of the DNS socket; bounds how long stopping the responder takes. */
+#define DNS_SERVER_POLL_MS 250
+
+/** @brief TTL of the A records returned by the DNS responder, in seconds. */
+#define DNS_ANSWER_TTL_S 60
+
+/** @} */
+
+/**
+ * @defgroup BootConfig Boot Sequencing Configuration
+ * @brief Tasks running the independent boot stages concurrently.
+ * @{
+ */
+
+/** @brief Maximum number of boot stages. */
+#define BOOT_MAX_STAGES 8
+
+/** @brief Stack size of each boot stage task (LittleFS mount and Wi-Fi driver init run on them). */
+#define BOOT_STAGE_STACK_SIZE 4096
+
+/** @brief Priority of the boot stage tasks. */
+#define BOOT_STAGE_PRIORITY 5
 
 /** @} */
 
@@ -31,12 +126,84 @@
 /** @brief Namespace used for NVS storage. */
 #define NVS_NAMESPACE "storage"
 
-/** @brief Key for storing Wi-Fi SSID in NVS. */
+/** @brief Legacy key of the single stored Wi-Fi SSID, migrated into the credential table on first load. */
 #define NVS_KEY_WIFI_SSID "wifi_ssid"
 
-/** @brief Key for storing Wi-Fi password in NVS. */
+/** @brief Legacy key of the single stored Wi-Fi password, migrated into the credential table on first load. */
 #define NVS_KEY_WIFI_PASS "wifi_pass"
 
+/** @brief Key prefix of the credential table entries ("net0", "net1", ...). */
+#define NVS_KEY_NET_PREFIX "net"
+
+/** @brief Key storing the success sequence counter used to order networks by last success. */
+#define NVS_KEY_NET_SEQ "net_seq"
+
+/** @brief Key for storing the fast-connect record (BSSID, channel, auth mode, PMK) of the last good AP. */
+#define NVS_KEY_WIFI_FAST "wifi_fast"
+
+/** @} */
+
+/**
+ * @defgroup CredentialStoreConfig Credential Store Configuration
+ * @brief Size of the multi-network credential table and weights of the network ranking.
+ * @{
+ */
+
+/** @brief Maximum number of stored networks. */
+#define CREDENTIAL_STORE_CAPACITY 8
+
+/** @brief Score added per priority level when ranking scanned networks (RSSI is in dBm). */
+#define CREDENTIAL_PRIORITY_WEIGHT 10
+
+/** @brief Score added to the most recently successful network; half of it for any earlier success. */
+#define CREDENTIAL_RECENCY_BONUS 8
+
+/** @brief Maximum number of AP records read from a single scan. */
+#define SCAN_MAX_RECORDS 20
+
+/** @} */
+
+/**
+ * @defgroup ScanCacheConfig Scan Cache Configuration
+ * @brief Background scanning in provisioning mode and the cache behind the /scan endpoint.
+ * @{
+ */
+
+/** @brief Maximum number of access points (distinct BSSIDs) kept in the scan cache. */
+#define SCAN_CACHE_CAPACITY 16
+
+/** @brief Interval between background scans while in provisioning mode. */
+#define SCAN_CACHE_REFRESH_MS 15000
+
+/** @brief Entries not seen for this long are dropped from the cache. */
+#define SCAN_CACHE_MAX_AGE_MS 60000
+
+/** @brief Active dwell time per channel of a background scan. */
+#define SCAN_CHANNEL_DWELL_MS 60
+
+/** @brief Time spent back on the AP's home channel between scanned channels, so AP clients are served. */
+#define SCAN_HOME_CHANNEL_DWELL_MS 30
+
+/** @} */
+
+/**
+ * @defgroup RoamingConfig Roaming Configuration
+ * @brief Opt-in roaming between access points of the same network.
+ * @{
+ */
+
+/** @brief Set to 1 to enable roaming (see WifiManager::setRoamingEnabled()). */
+#define WIFI_ROAMING_ENABLED 0
+
+/** @brief RSSI in dBm below which a better access point is searched for. */
+#define ROAM_RSSI_THRESHOLD (-70)
+
+/** @brief Minimum RSSI improvement in dB a candidate must offer before the station moves. */
+#define ROAM_MIN_RSSI_GAIN 8
+
+/** @brief Delay before the RSSI threshold is re-armed after a roaming attempt. */
+#define ROAM_RETRIGGER_MS 30000
+
 /** @} */
 
 /**
@@ -51,4 +218,169 @@
 /** @brief Base path for mounting the LittleFS filesystem. */
 #define LFS_BASE_PATH "/littlefs"
 
+/** @brief If 1, the filesystem is mounted at boot; if 0, on first use (provisioning or a file request). */
+#define LFS_MOUNT_AT_BOOT 0
+
+/** @} */
+
+/**
+ * @defgroup AssetCacheConfig Asset Cache Configuration
+ * @brief In-memory copy of the web assets served from LittleFS.
+ * @{
+ */
+
+/** @brief If 1, web assets are loaded into RAM once and served from there; if 0, streamed from LittleFS per request. */
+#define ASSET_CACHE_ENABLED 1
+
+/** @brief Maximum size of the cache buffer in bytes; assets that do not fit are streamed from LittleFS. */
+#define ASSET_CACHE_MAX_BYTES (32 * 1024)
+
+/** @brief Maximum number of cached assets. */
+#define ASSET_CACHE_MAX_ENTRIES 4
+
+/** @brief Cache-Control sent with cached assets; "no-cache" lets browsers keep the page but revalidate it with its ETag. */
+#define ASSET_CACHE_CONTROL "no-cache"
+
+/** @} */
+
+/**
+ * @defgroup StaticFileConfig Static File Server Configuration
+ * @brief Serving of arbitrary files from the LittleFS partition under /static/.
+ * @{
+ */
+
+/** @brief Directory on the partition (below LFS_BASE_PATH) whose files are served as /static/<path>. */
+#define STATIC_FILES_DIR "/static"
+
+/** @brief Maximum length of a resolved file path, including LFS_BASE_PATH. */
+#define STATIC_MAX_PATH_LEN 96
+
+/** @} */
+
+/**
+ * @defgroup FileStreamConfig File Streaming Configuration
+ * @brief Buffers and chunking of file responses streamed from LittleFS.
+ * @{
+ */
+
+/** @brief Size of the read buffer in bytes; the upper bound of the chunk size. */
+#define FILE_STREAM_BUFFER_SIZE 4096
+
+/** @brief Bytes read from the file and passed to the socket per step. */
+#define FILE_STREAM_CHUNK_SIZE 4096
+
+/** @brief If 1, each response uses the next chunk size of FileStreamer::SWEEP_SIZES, so /status reports the throughput of every size. */
+#define FILE_STREAM_SWEEP 0
+
+/** @} */
+
+/**
+ * @defgroup FlashAssetConfig Memory-Mapped Asset Partition Configuration
+ * @brief Read-only asset image written by scripts/build_assets.py and served straight from flash.
+ * @{
+ */
+
+/** @brief If 1, assets found in the asset partition are served from it before LittleFS is consulted. */
+#define FLASH_ASSETS_ENABLED 1
+
+/** @brief Label of the asset partition defined in partition_custom.csv. */
+#define FLASH_ASSETS_PARTITION_LABEL "assets"
+
+/** @brief Subtype of the asset partition (custom data subtype). */
+#define FLASH_ASSETS_PARTITION_SUBTYPE 0x40
+
+/** @} */
+
+/**
+ * @defgroup ControlServerConfig Station Control Server Configuration
+ * @brief HTTP server offering /reset and /status while connected as a station.
+ * @{
+ */
+
+/**
+ * @brief If 1, the control server starts whenever the station gets an IP; if 0, only after WifiManager::setControlServerEnabled(true).
+ *
+ * /reset is the only way back to provisioning on a connected device, so only clear this if the
+ * application offers another one.
+ */
+#define STA_CONTROL_SERVER_ENABLED 1
+
+/** @} */
+
+/**
+ * @defgroup IPConfig IP Addressing Configuration
+ * @brief Timing for the reuse-last-lease IP mode.
+ * @{
+ */
+
+/** @brief Interval between the ARP probes that confirm a reused lease. */
+#define LEASE_VERIFY_INTERVAL_MS 500
+
+/** @brief ARP probes sent for a reused lease; if the gateway never answers, the cached address is kept. */
+#define LEASE_VERIFY_PROBES 3
+
+/** @} */
+
+/**
+ * @defgroup ConnectionTaskConfig Connection Task Configuration
+ * @brief Task running the connection state machine.
+ * @{
+ */
+
+/** @brief Stack size of the connection task (scan, PMK derivation and web server start run on it). */
+#define WIFI_TASK_STACK_SIZE 6144
+
+/** @brief Priority of the connection task. */
+#define WIFI_TASK_PRIORITY 5
+
+/** @brief Depth of the connection event queue. */
+#define WIFI_EVENT_QUEUE_LENGTH 8
+
+/** @brief Time a single association attempt may take before it is aborted. */
+#define WIFI_CONNECT_TIMEOUT_MS 30000
+
+/** @brief Number of connection attempts whose phase timings are kept (see WifiManager::getConnectionTimings()). */
+#define CONNECTION_TIMING_HISTORY 8
+
+/** @brief Maximum number of queues subscribed to connectivity changes (see WifiManager::subscribe()). */
+#define LINK_EVENT_MAX_SUBSCRIBERS 4
+
+/** @brief Depth of the connectivity event queue of the application task. */
+#define LINK_EVENT_QUEUE_LENGTH 4
+
+/** @} */
+
+/**
+ * @defgroup ReconnectConfig Reconnection Backoff Configuration
+ * @brief Exponential backoff and per-category retry budgets for station reconnection.
+ * @{
+ */
+
+/** @brief Delay before the first reconnection attempt. */
+#define RECONNECT_BASE_DELAY_MS 500
+
+/** @brief Upper bound for the backoff delay between attempts. */
+#define RECONNECT_MAX_DELAY_MS 60000
+
+/** @brief Factor applied to the delay after every failed attempt. */
+#define RECONNECT_BACKOFF_MULTIPLIER 2
+
+/** @brief Random jitter applied to each delay, in percent of the delay (+/-). */
+#define RECONNECT_JITTER_PERCENT 20
+
+/** @brief Attempts allowed after transient failures (beacon loss, association timeout, ...), until the first connection. */
+#define RECONNECT_TRANSIENT_BUDGET 5
+
+/** @brief Attempts allowed after the AP deauthenticated or rejected the station, until the first connection. */
+#define RECONNECT_AP_KICK_BUDGET 3
+
+/** @brief Minimum delay before reconnecting after the AP deauthenticated or rejected the station. */
+#define RECONNECT_AP_KICK_DELAY_MS 5000
+
+/** @brief Attempts allowed after authentication or handshake failures (wrong password), until the first connection. */
+#define RECONNECT_AUTH_BUDGET 0
+
+/** @brief Attempts allowed when the SSID is not found, until the first connection. */
+#define RECONNECT_NO_AP_BUDGET 0
+
 /** @} */
\ No newline at end of file
@@ -20,6 +20,8 @@ extern "C" {
 #include "freertos/FreeRTOS.h"      
 #include "freertos/task.h"          
 #include "freertos/event_groups.h"  
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 
 /**
@@ -32,6 +34,9 @@ extern "C" {
 #include "esp_system.h"             
 #include "nvs_flash.h"              
 #include "esp_mac.h"                
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
 
 
 /**
@@ -44,6 +49,7 @@ extern "C" {
 #include "esp_netif.h"              
 #include "esp_http_server.h"        
 #include "esp_littlefs.h"           
+#include "esp_partition.h"
 
 #ifdef __cplusplus
 }
@@ -55,5 +61,6 @@ extern "C" {
  * 
  */
 #include <string>                  
+#include <cinttypes>
 #include <vector>                   
 #include <functional>               
@@ -0,0 +1,155 @@
+"""
+@file build_assets.py
+@brief Minifies and gzips the web assets in data/ for the LittleFS image and the asset partition.
+
+Each file in the source directory is written to the output directory twice: minified (for
+clients that do not accept gzip) and as a gzip-compressed ".gz" sibling, which the firmware
+sends with "Content-Encoding: gzip". Files that do not shrink (e.g. images) get no sibling.
+HTML loses its comments (including those inside <style> and <script>), full-line // comments
+in scripts and all indentation; other files are copied unchanged before compression.
+
+The output is also packed into an image for the read-only "assets" partition, which the
+firmware maps with esp_partition_mmap() and serves without a copy (see FlashAssetStore.h for
+the layout).
+
+Used by PlatformIO as a pre-script (see extra_scripts in platformio.ini), which regenerates
+the output in PROJECT_DATA_DIR before buildfs/uploadfs pack it, and adds the asset image to
+the images flashed by "upload". It can also be run by hand:
+
+    python scripts/build_assets.py <source dir> <output dir> [<image> <partition size>]
+"""
+
+import csv
+import gzip
+import os
+import re
+import shutil
+import struct
+import sys
+
+HTML_COMMENT = re.compile(r"<!--.*?-->", re.DOTALL)
+CSS_COMMENT = re.compile(r"/\*.*?\*/", re.DOTALL)
+SCRIPT_BLOCK = re.compile(r"(<script[^>]*>)(.*?)(</script>)", re.DOTALL | re.IGNORECASE)
+STYLE_BLOCK = re.compile(r"(<style[^>]*>)(.*?)(</style>)", re.DOTALL | re.IGNORECASE)
+
+IMAGE_MAGIC = 0x31545341  # "AST1"
+IMAGE_PARTITION = "assets"
+ENTRY_PATH_SIZE = 32
+ENTRY_FLAG_GZIP = 0x01
+
+
+def minify_html(text):
+    """Strips comments and indentation; line breaks are kept so scripts relying on ASI still parse."""
+    text = HTML_COMMENT.sub("", text)
+    text = STYLE_BLOCK.sub(lambda m: m.group(1) + CSS_COMMENT.sub("", m.group(2)) + m.group(3), text)
+    text = SCRIPT_BLOCK.sub(
+        lambda m: m.group(1)
+        + "\n".join(line for line in m.group(2).splitlines() if not line.strip().startswith("//"))
+        + m.group(3),
+        text,
+    )
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line)
+
+
+def build(source_dir, output_dir):
+    """Writes the minified and gzipped copy of every file in source_dir to output_dir."""
+    if os.path.realpath(source_dir) == os.path.realpath(output_dir):
+        sys.exit("assets: output directory must differ from the source directory")
+    if os.path.isdir(output_dir):
+        shutil.rmtree(output_dir)
+    os.makedirs(output_dir)
+
+    for root, _, files in os.walk(source_dir):
+        for name in sorted(files):
+            source = os.path.join(root, name)
+            target = os.path.join(output_dir, os.path.relpath(source, source_dir))
+            os.makedirs(os.path.dirname(target), exist_ok=True)
+
+            with open(source, "rb") as f:
+                data = f.read()
+            if name.endswith((".html", ".htm")):
+                data = minify_html(data.decode("utf-8")).encode("utf-8")
+            # mtime=0 keeps the output identical for unchanged sources.
+            compressed = gzip.compress(data, compresslevel=9, mtime=0)
+
+            with open(target, "wb") as f:
+                f.write(data)
+            if len(compressed) < len(data):
+                with open(target + ".gz", "wb") as f:
+                    f.write(compressed)
+            print("assets: %s %d -> %d (minified) -> %d (gzip) bytes"
+                  % (os.path.relpath(source, source_dir), os.path.getsize(source), len(data), len(compressed)))
+
+
+def fnv1a(data):
+    """32-bit FNV-1a, the ETag hash also used by the firmware's asset cache."""
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def pack(output_dir, image_path, max_size):
+    """Packs the files in output_dir into an asset partition image; gzip variants come first."""
+    entries = []
+    for root, _, files in os.walk(output_dir):
+        for name in sorted(files):
+            if name.endswith(".gz"):
+                continue
+            path = "/" + os.path.relpath(os.path.join(root, name), output_dir).replace(os.sep, "/")
+            if len(path) >= ENTRY_PATH_SIZE:
+                sys.exit("assets: path too long for the asset image: %s" % path)
+            for suffix, flags in ((".gz", ENTRY_FLAG_GZIP), ("", 0)):
+                variant = os.path.join(root, name + suffix)
+                if os.path.exists(variant):
+                    with open(variant, "rb") as f:
+                        entries.append((path, flags, f.read()))
+
+    header_size = 8 + 48 * len(entries)
+    directory = b""
+    blob = b""
+    for path, flags, data in entries:
+        offset = header_size + len(blob)
+        directory += struct.pack("<32sIIIB3x", path.encode("ascii"), offset, len(data), fnv1a(data), flags)
+        blob += data + b"\0" * (-len(data) % 4)
+    image = struct.pack("<II", IMAGE_MAGIC, len(entries)) + directory + blob
+    if len(image) > max_size:
+        sys.exit("assets: image of %d bytes does not fit the %d byte asset partition" % (len(image), max_size))
+
+    os.makedirs(os.path.dirname(image_path) or ".", exist_ok=True)
+    with open(image_path, "wb") as f:
+        f.write(image)
+    print("assets: %d entries, %d of %d bytes in %s" % (len(entries), len(image), max_size, image_path))
+
+
+def find_partition(table_path, label):
+    """Returns (offset, size) of a partition in a CSV partition table, or None."""
+    with open(table_path) as f:
+        rows = csv.reader(line for line in f if line.strip() and not line.lstrip().startswith("#"))
+        for row in rows:
+            fields = [field.strip() for field in row]
+            if fields and fields[0] == label:
+                return int(fields[3], 0), int(fields[4], 0)
+    return None
+
+
+try:
+    Import("env")  # noqa: F821 - provided by SCons when run by PlatformIO
+    project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+    output_dir = env.subst("$PROJECT_DATA_DIR")  # noqa: F821
+    build(os.path.join(project_dir, "data"), output_dir)
+
+    table = os.path.join(project_dir, env.GetProjectOption("board_build.partitions", "partitions.csv"))  # noqa: F821
+    partition = find_partition(table, IMAGE_PARTITION) if os.path.exists(table) else None
+    if partition:
+        image_path = os.path.join(env.subst("$BUILD_DIR"), "assets.bin")  # noqa: F821
+        pack(output_dir, image_path, partition[1])
+        env.Append(FLASH_EXTRA_IMAGES=[("0x%x" % partition[0], image_path)])  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) not in (3, 5):
+            sys.exit("usage: build_assets.py <source dir> <output dir> [<image> <partition size>]")
+        build(sys.argv[1], sys.argv[2])
+        if len(sys.argv) == 5:
+            pack(sys.argv[2], sys.argv[3], int(sys.argv[4], 0))
@@ -14,7 +14,7 @@ static const char *TAG = "Application";
  *
  * Initializes the Application instance.
  */
-Application::Application() {}
+Application::Application() : m_wifi(m_fs) {}
 
 /**
  * @brief Initializes the Non-Volatile Storage (NVS) partition.
@@ -36,84 +36,53 @@ void Application::initializeNVS()
     ESP_LOGI(TAG, "NVS successfully initialized.");
 }
 
-/**
- * @brief Initializes and mounts the LittleFS filesystem.
- *
- * Configures and registers the LittleFS driver with the Virtual File System (VFS)
- * using the base path and partition label defined in config.h. Handles mounting
- * or formatting if necessary, and logs partition information.
- */
-void Application::initializeFS()
-{
-    ESP_LOGI(TAG, "Initializing LittleFS...");
-    esp_vfs_littlefs_conf_t conf = {
-        .base_path = LFS_BASE_PATH,            
-        .partition_label = LFS_PARTITION_LABEL, 
-        .partition = NULL,                     
-        .format_if_mount_failed = true,        
-        .read_only = false,                    
-        .dont_mount = false,                   
-        .grow_on_mount = false,                
-    };
-
-    esp_err_t ret = esp_vfs_littlefs_register(&conf);
-
-    if (ret != ESP_OK)
-    {
-        if (ret == ESP_FAIL)
-        {
-            ESP_LOGE(TAG, "Failed to mount or format filesystem");
-        }
-        else if (ret == ESP_ERR_NOT_FOUND)
-        {
-            ESP_LOGE(TAG, "Failed to find LittleFS partition. Ensure '%s' exists in partition_custom.csv", LFS_PARTITION_LABEL);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Failed to initialize LittleFS (%s)", esp_err_to_name(ret));
-        }
-        return;
-    }
-
-    size_t total = 0, used = 0;
-    ret = esp_littlefs_info(conf.partition_label, &total, &used);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to retrieve LittleFS partition info (%s)", esp_err_to_name(ret));
-    }
-    else
-    {
-        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
-    }
-    ESP_LOGI(TAG, "LittleFS successfully mounted at path: %s", LFS_BASE_PATH);
-}
-
 /**
  * @brief Executes the main application logic.
  *
- * Initializes NVS and LittleFS, starts the Wi-Fi manager, and enters an infinite loop
- * to monitor connection status and perform application tasks.
+ * Runs the boot stages along their real dependencies: the Wi-Fi driver needs NVS and the
+ * network stack. LittleFS is mounted on first use; with LFS_MOUNT_AT_BOOT it is mounted by a
+ * stage that depends on nothing, so it overlaps with both.
+ * Then subscribes to connectivity changes, starts the Wi-Fi manager without waiting for the
+ * connection, and blocks until the next change is delivered.
  */
 void Application::run()
 {
     ESP_LOGI(TAG, "Application started.");
 
-    initializeNVS();
-    initializeFS();
+    size_t nvs = m_boot.add("boot_nvs", [this] { initializeNVS(); });
+    size_t network = m_boot.add("boot_netif", [this] { m_wifi.initNetwork(); });
+    m_boot.add("boot_wifi", [this] { m_wifi.initDriver(); }, BootSequencer::after(nvs) | BootSequencer::after(network));
+#if LFS_MOUNT_AT_BOOT
+    m_boot.add("boot_fs", [this] { m_fs.ensureMounted(); });
+#endif
+    m_boot.run();
+
+    QueueHandle_t link_events = xQueueCreate(LINK_EVENT_QUEUE_LENGTH, sizeof(LinkEventPublisher::LinkEvent));
+    ESP_ERROR_CHECK(link_events ? ESP_OK : ESP_ERR_NO_MEM);
+    ESP_ERROR_CHECK(m_wifi.subscribe(link_events));
 
+    m_wifi.setStateCallback([](WifiManager::ConnectionState state) {
+        ESP_LOGI(TAG, "Wi-Fi state: %s", ConnectionStateMachine::toString(state));
+    });
+    m_wifi.setRoamingEnabled(WIFI_ROAMING_ENABLED);
     m_wifi.start();
 
-    while (true)
+    LinkEventPublisher::LinkEvent event;
+    while (xQueueReceive(link_events, &event, portMAX_DELAY) == pdTRUE)
     {
-        if (m_wifi.isConnected())
-        {
-            ESP_LOGI(TAG, "Device connected. IP: %s", m_wifi.getIpAddress().c_str());
-
-        }
-        else
+        switch (event.type)
         {
-            ESP_LOGI(TAG, "Device in provisioning mode...");
+            case LinkEventPublisher::Type::Up:
+            case LinkEventPublisher::Type::IpChanged:
+                ESP_LOGI(TAG, "Link %s. IP: " IPSTR ", RSSI: %d dBm", LinkEventPublisher::toString(event.type),
+                         IP2STR(&event.ip), event.rssi);
+                break;
+            case LinkEventPublisher::Type::Down:
+                ESP_LOGI(TAG, "Link down (reason %u)", event.reason);
+                break;
+            case LinkEventPublisher::Type::Roamed:
+                ESP_LOGI(TAG, "Roamed to " MACSTR " on channel %u", MAC2STR(event.bssid), event.channel);
+                break;
         }
-        vTaskDelay(pdMS_TO_TICKS(10000)); 
     }
-}
\ No newline at end of file
+}
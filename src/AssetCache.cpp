@@ -0,0 +1,248 @@
+/**
+ * @file AssetCache.cpp
+ * @brief Implementation of the AssetCache class keeping web assets in RAM.
+ */
+
+#include "AssetCache.h"
+#include <cstring>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** @brief Logging tag for the AssetCache class. */
+static const char* TAG = "AssetCache";
+
+/**
+ * @brief Constructs an empty AssetCache object.
+ *
+ * @param fs Filesystem to load from; mounted on first use.
+ * @param assets Files to cache; must outlive the cache.
+ * @param count Number of entries in @p assets.
+ */
+AssetCache::AssetCache(LazyFileSystem& fs, const Asset* assets, size_t count) :
+    m_fs(fs),
+    m_assets(assets),
+    m_count(count < CAPACITY ? count : CAPACITY),
+    m_entries{},
+    m_buffer(nullptr),
+    m_loaded(false),
+    m_stats{},
+    m_mutex(xSemaphoreCreateMutex())
+{
+}
+
+/**
+ * @brief Destroys the AssetCache object and frees the buffer.
+ */
+AssetCache::~AssetCache() {
+    releaseLocked();
+    if (m_mutex) vSemaphoreDelete(m_mutex);
+}
+
+/**
+ * @brief Loads the assets into the buffer unless it is loaded already.
+ *
+ * @return esp_err_t ESP_OK if the buffer is loaded, error code otherwise.
+ */
+esp_err_t AssetCache::load() {
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    esp_err_t ret = m_loaded ? ESP_OK : loadLocked();
+    xSemaphoreGive(m_mutex);
+    return ret;
+}
+
+/**
+ * @brief Drops the buffer; call after the files in the storage partition have changed.
+ */
+void AssetCache::invalidate() {
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    releaseLocked();
+    xSemaphoreGive(m_mutex);
+    ESP_LOGI(TAG, "Invalidated");
+}
+
+/**
+ * @brief Sends a cached asset as the complete response, loading the buffer if needed.
+ *
+ * Answers with 304 Not Modified if If-None-Match matches the ETag of the chosen variant.
+ * Variants are tried in table order, so gzip-encoded ones should be listed first.
+ *
+ * @param req HTTP request handle.
+ * @param path Path of the asset as given in Asset::path.
+ * @return esp_err_t Result of httpd_resp_send(), or ESP_ERR_NOT_FOUND if no acceptable variant is cached.
+ */
+esp_err_t AssetCache::send(httpd_req_t* req, const char* path) {
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    if (!m_loaded) loadLocked();
+
+    bool gzip = acceptsGzip(req);
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    for (size_t i = 0; i < m_count; i++) {
+        const Asset& asset = m_assets[i];
+        if (!m_entries[i].cached || strcmp(asset.path, path) != 0) continue;
+        if (asset.encoding && !(gzip && strcmp(asset.encoding, "gzip") == 0)) continue;
+        const Entry& entry = m_entries[i];
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        httpd_resp_set_hdr(req, "ETag", entry.etag);
+        httpd_resp_set_hdr(req, "Cache-Control", ASSET_CACHE_CONTROL);
+        if (matchesIfNoneMatch(req, entry.etag)) {
+            m_stats.not_modified++;
+            httpd_resp_set_status(req, "304 Not Modified");
+            ret = httpd_resp_send(req, NULL, 0);
+            break;
+        }
+        httpd_resp_set_type(req, asset.type);
+        if (asset.encoding) httpd_resp_set_hdr(req, "Content-Encoding", asset.encoding);
+        ret = httpd_resp_send(req, (const char*) m_buffer + entry.offset, entry.size);
+        if (ret == ESP_OK) m_stats.bytes_sent += entry.size;
+        break;
+    }
+    if (ret == ESP_ERR_NOT_FOUND) {
+        m_stats.misses++;
+    } else {
+        m_stats.hits++;
+    }
+    xSemaphoreGive(m_mutex);
+    return ret;
+}
+
+/**
+ * @brief Checks whether the client accepts gzip-encoded responses.
+ *
+ * @param req HTTP request handle.
+ * @return true if Accept-Encoding lists gzip without q=0.
+ */
+bool AssetCache::acceptsGzip(httpd_req_t* req) {
+    char value[64];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value));
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) return false;  // a truncated list is still usable
+
+    char* save = nullptr;
+    for (char* token = strtok_r(value, ",", &save); token; token = strtok_r(nullptr, ",", &save)) {
+        while (*token == ' ') token++;
+        if (strncmp(token, "gzip", 4) != 0 || (token[4] != '\0' && token[4] != ';' && token[4] != ' ')) continue;
+        const char* q = strstr(token, "q=");
+        return !q || strtof(q + 2, nullptr) > 0.0f;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether the request's If-None-Match header matches an ETag.
+ *
+ * Uses the weak comparison required for If-None-Match, so W/ prefixes are ignored.
+ *
+ * @param req HTTP request handle.
+ * @param etag Quoted ETag of the selected variant.
+ * @return true if the client's copy is current.
+ */
+bool AssetCache::matchesIfNoneMatch(httpd_req_t* req, const char* etag) {
+    char value[96];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK) return false;
+    return strcmp(value, "*") == 0 || strstr(value, etag) != nullptr;
+}
+
+/**
+ * @brief Retrieves a copy of the counters.
+ *
+ * @return Stats Current counters.
+ */
+AssetCache::Stats AssetCache::getStats() const {
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    Stats stats = m_stats;
+    xSemaphoreGive(m_mutex);
+    return stats;
+}
+
+/**
+ * @brief Reads the assets into a newly allocated buffer. Mutex must be held.
+ *
+ * Sizes are taken first so the buffer is allocated once; assets that would exceed
+ * ASSET_CACHE_MAX_BYTES, or that cannot be read, are left out. The ETag of each asset is
+ * computed here, so revalidations never touch the filesystem.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t AssetCache::loadLocked() {
+    esp_err_t ret = m_fs.ensureMounted();
+    if (ret != ESP_OK) return ret;
+
+    int64_t start_us = esp_timer_get_time();
+    char filepath[64];
+    size_t total = 0;
+    for (size_t i = 0; i < m_count; i++) {
+        Entry& entry = m_entries[i];
+        entry = {};
+        snprintf(filepath, sizeof(filepath), LFS_BASE_PATH "%s", m_assets[i].file);
+        struct stat st;
+        if (stat(filepath, &st) != 0) {
+            ESP_LOGW(TAG, "%s not found", filepath);
+            continue;
+        }
+        if (total + (size_t) st.st_size > ASSET_CACHE_MAX_BYTES) {
+            ESP_LOGW(TAG, "%s (%u bytes) exceeds the cache size, will be streamed", filepath, (unsigned) st.st_size);
+            continue;
+        }
+        entry.offset = total;
+        entry.size = (size_t) st.st_size;
+        total += entry.size;
+    }
+
+    if (total > 0) {
+        m_buffer = static_cast<uint8_t*>(heap_caps_malloc(total, MALLOC_CAP_8BIT));
+        if (!m_buffer) {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes", (unsigned) total);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    size_t cached = 0;
+    for (size_t i = 0; i < m_count; i++) {
+        Entry& entry = m_entries[i];
+        if (entry.size == 0) continue;
+        snprintf(filepath, sizeof(filepath), LFS_BASE_PATH "%s", m_assets[i].file);
+        int fd = open(filepath, O_RDONLY, 0);
+        if (fd == -1) {
+            ESP_LOGW(TAG, "Failed to open %s", filepath);
+            continue;
+        }
+        size_t done = 0;
+        ssize_t bytes_read;
+        while (done < entry.size && (bytes_read = read(fd, m_buffer + entry.offset + done, entry.size - done)) > 0) {
+            done += (size_t) bytes_read;
+        }
+        close(fd);
+        entry.cached = done == entry.size;
+        if (entry.cached) {
+            // FNV-1a; strong enough to tell builds apart, cheap enough to run on every load.
+            uint32_t hash = 2166136261u;
+            for (size_t b = 0; b < entry.size; b++) {
+                hash = (hash ^ m_buffer[entry.offset + b]) * 16777619u;
+            }
+            snprintf(entry.etag, sizeof(entry.etag), "\"%08" PRIx32 "\"", hash);
+            cached += entry.size;
+        } else {
+            ESP_LOGW(TAG, "Short read on %s", filepath);
+        }
+    }
+
+    m_loaded = true;
+    m_stats.loads++;
+    m_stats.bytes = cached;
+    m_stats.load_us = (uint32_t) (esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Loaded %u bytes in %" PRIu32 " ms", (unsigned) cached, m_stats.load_us / 1000);
+    return ESP_OK;
+}
+
+/**
+ * @brief Frees the buffer and forgets all entries. Mutex must be held.
+ */
+void AssetCache::releaseLocked() {
+    if (m_buffer) heap_caps_free(m_buffer);
+    m_buffer = nullptr;
+    for (Entry& entry : m_entries) {
+        entry = {};
+    }
+    m_loaded = false;
+    m_stats.bytes = 0;
+}
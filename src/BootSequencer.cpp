@@ -0,0 +1,120 @@
+/**
+ * @file BootSequencer.cpp
+ * @brief Implementation of the BootSequencer class running boot stages along their dependencies.
+ */
+
+#include "BootSequencer.h"
+
+/** @brief Logging tag for the BootSequencer class. */
+static const char* TAG = "Boot";
+
+static_assert(BOOT_MAX_STAGES <= 24, "Event groups hold at most 24 stage bits");
+
+/**
+ * @brief Constructs a BootSequencer without stages.
+ */
+BootSequencer::BootSequencer() :
+    m_stages{},
+    m_count(0),
+    m_done(xEventGroupCreate())
+{
+}
+
+/**
+ * @brief Destroys the BootSequencer object and its event group.
+ *
+ * Stage tasks may still be returning from setting their bit right after run() returns, so
+ * the sequencer should live for the lifetime of the application.
+ */
+BootSequencer::~BootSequencer() {
+    if (m_done) vEventGroupDelete(m_done);
+}
+
+/**
+ * @brief Adds a stage. Stages may only depend on stages added before them.
+ *
+ * Dependencies on later or unknown stages are dropped, which keeps the graph acyclic.
+ *
+ * @param name Name used in the log; must outlive run().
+ * @param action Stage body.
+ * @param depends_on Mask of stages (see after()) that must finish first.
+ * @return size_t Identifier of the stage.
+ */
+size_t BootSequencer::add(const char* name, Action action, uint32_t depends_on) {
+    configASSERT(m_count < CAPACITY);
+    size_t index = m_count++;
+    Stage& stage = m_stages[index];
+    stage.name = name;
+    stage.action = std::move(action);
+    stage.depends_on = depends_on & (after(index) - 1);
+    stage.owner = this;
+    stage.index = index;
+    return index;
+}
+
+/**
+ * @brief Runs all stages and blocks until every one of them has finished.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if a stage task could not be created
+ *         (that stage is then run on the calling task).
+ */
+esp_err_t BootSequencer::run() {
+    if (!m_done) return ESP_ERR_NO_MEM;
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < m_count; i++) {
+        if (xTaskCreate(&stageTask, m_stages[i].name, BOOT_STAGE_STACK_SIZE, &m_stages[i],
+                        BOOT_STAGE_PRIORITY, nullptr) != pdPASS) {
+            // Dependencies are always earlier stages whose tasks already exist, so waiting here cannot deadlock.
+            ESP_LOGW(TAG, "No task for stage '%s', running it inline", m_stages[i].name);
+            result = ESP_ERR_NO_MEM;
+            execute(m_stages[i]);
+        }
+    }
+
+    EventBits_t all = (EventBits_t) (after(m_count) - 1);
+    xEventGroupWaitBits(m_done, all, pdFALSE, pdTRUE, portMAX_DELAY);
+    int64_t end_us = esp_timer_get_time();
+
+    int64_t sequential_us = 0;
+    for (size_t i = 0; i < m_count; i++) {
+        const Stage& stage = m_stages[i];
+        int64_t run_us = stage.end_us - stage.start_us;
+        sequential_us += run_us;
+        ESP_LOGI(TAG, "Stage '%s': waited %" PRId64 " ms, ran %" PRId64 " ms", stage.name,
+                 (stage.start_us - start_us) / 1000, run_us / 1000);
+    }
+    ESP_LOGI(TAG, "Boot stages finished in %" PRId64 " ms (%" PRId64 " ms if run sequentially)",
+             (end_us - start_us) / 1000, sequential_us / 1000);
+    return result;
+}
+
+/**
+ * @brief Stage task entry; waits for the dependencies, runs the stage and signals it.
+ *
+ * @param arg Pointer to the Stage.
+ */
+void BootSequencer::stageTask(void* arg) {
+    Stage* stage = static_cast<Stage*>(arg);
+    stage->owner->execute(*stage);
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Waits for the dependencies of a stage, runs it and records its timings.
+ *
+ * The stage must not be touched after its bit is set: run() may return and the
+ * sequencer go out of scope right away.
+ *
+ * @param stage The stage.
+ */
+void BootSequencer::execute(Stage& stage) {
+    if (stage.depends_on) {
+        xEventGroupWaitBits(m_done, (EventBits_t) stage.depends_on, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+    stage.start_us = esp_timer_get_time();
+    stage.action();
+    stage.end_us = esp_timer_get_time();
+    xEventGroupSetBits(m_done, (EventBits_t) after(stage.index));
+}
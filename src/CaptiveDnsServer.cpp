@@ -0,0 +1,218 @@
+/**
+ * @file CaptiveDnsServer.cpp
+ * @brief Implementation of the CaptiveDnsServer class resolving every name to the provisioning AP.
+ */
+
+#include "CaptiveDnsServer.h"
+#include <cstring>
+#include "lwip/sockets.h"
+
+/** @brief Logging tag for the CaptiveDnsServer class. */
+static const char* TAG = "CaptiveDns";
+
+/** @brief Size of the DNS header. */
+static constexpr size_t DNS_HEADER_SIZE = 12;
+
+/** @brief Size of the A record appended to an answer (name pointer, type, class, TTL, length, address). */
+static constexpr size_t DNS_ANSWER_SIZE = 16;
+
+/** @brief Largest DNS message over UDP without EDNS. */
+static constexpr size_t DNS_MAX_PACKET = 512;
+
+/** @brief Query type A. */
+static constexpr uint16_t DNS_TYPE_A = 1;
+
+/** @brief Query type ANY. */
+static constexpr uint16_t DNS_TYPE_ANY = 255;
+
+/** @brief Query class IN. */
+static constexpr uint16_t DNS_CLASS_IN = 1;
+
+/**
+ * @brief Reads a big-endian 16-bit value.
+ *
+ * @param p Pointer to the value.
+ * @return uint16_t The value.
+ */
+static inline uint16_t readU16(const uint8_t* p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+/**
+ * @brief Writes a big-endian 16-bit value.
+ *
+ * @param p Destination.
+ * @param value The value.
+ */
+static inline void writeU16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t) (value >> 8);
+    p[1] = (uint8_t) value;
+}
+
+/**
+ * @brief Constructs a stopped CaptiveDnsServer object.
+ */
+CaptiveDnsServer::CaptiveDnsServer() :
+    m_address{},
+    m_task(nullptr),
+    m_running(false),
+    m_exited(true),
+    m_answered(0)
+{
+}
+
+/**
+ * @brief Stops the responder.
+ */
+CaptiveDnsServer::~CaptiveDnsServer() {
+    stop();
+}
+
+/**
+ * @brief Starts the responder task. Does nothing if it is already running.
+ *
+ * @param address AP address to bind to and to return in every answer.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the task could not be created.
+ */
+esp_err_t CaptiveDnsServer::start(esp_ip4_addr_t address) {
+    if (m_task) return ESP_OK;
+
+    m_address = address;
+    m_answered = 0;
+    m_exited = false;
+    m_running = true;
+    if (xTaskCreate(&task, "captive_dns", DNS_SERVER_TASK_STACK_SIZE, this, DNS_SERVER_TASK_PRIORITY, &m_task) != pdPASS) {
+        m_running = false;
+        m_exited = true;
+        m_task = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Stops the responder task and waits for it to exit.
+ *
+ * The socket has a receive timeout of DNS_SERVER_POLL_MS, so the wait is bounded by it.
+ */
+void CaptiveDnsServer::stop() {
+    if (!m_task) return;
+
+    m_running = false;
+    while (!m_exited) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    m_task = nullptr;
+    ESP_LOGI(TAG, "Stopped after answering %" PRIu32 " queries", answeredQueries());
+}
+
+/**
+ * @brief Returns the number of queries answered since the last start.
+ *
+ * @return uint32_t Answered queries.
+ */
+uint32_t CaptiveDnsServer::answeredQueries() const {
+    return m_answered.load();
+}
+
+/**
+ * @brief Task entry; receives queries until stop() is called.
+ *
+ * @param arg Pointer to the CaptiveDnsServer instance.
+ */
+void CaptiveDnsServer::task(void* arg) {
+    CaptiveDnsServer* self = static_cast<CaptiveDnsServer*>(arg);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket (errno %d)", errno);
+    } else {
+        struct sockaddr_in bind_addr = {};
+        bind_addr.sin_family = AF_INET;
+        bind_addr.sin_port = htons(53);
+        bind_addr.sin_addr.s_addr = self->m_address.addr;
+
+        struct timeval timeout = {};
+        timeout.tv_sec = DNS_SERVER_POLL_MS / 1000;
+        timeout.tv_usec = (DNS_SERVER_POLL_MS % 1000) * 1000;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        if (bind(sock, (struct sockaddr*) &bind_addr, sizeof(bind_addr)) < 0) {
+            ESP_LOGE(TAG, "Failed to bind port 53 (errno %d)", errno);
+        } else {
+            ESP_LOGI(TAG, "Answering DNS queries with " IPSTR, IP2STR(&self->m_address));
+            uint8_t packet[DNS_MAX_PACKET];
+            while (self->m_running) {
+                struct sockaddr_in client = {};
+                socklen_t client_len = sizeof(client);
+                int received = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr*) &client, &client_len);
+                if (received <= 0) continue;
+
+                size_t length = self->buildAnswer(packet, (size_t) received, sizeof(packet));
+                if (length == 0) continue;
+                if (sendto(sock, packet, length, 0, (struct sockaddr*) &client, client_len) > 0) {
+                    self->m_answered++;
+                }
+            }
+        }
+        close(sock);
+    }
+
+    // A failed socket leaves the task parked until stop() so start() stays idempotent.
+    while (self->m_running) {
+        vTaskDelay(pdMS_TO_TICKS(DNS_SERVER_POLL_MS));
+    }
+    self->m_exited = true;
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Turns a query in @p packet into the answer in place.
+ *
+ * Only the first question is kept; additional records (e.g. EDNS) are dropped. A and ANY
+ * questions of class IN get one A record pointing at the AP; other types get no records.
+ *
+ * @param packet Buffer holding the query; receives the answer.
+ * @param length Length of the query.
+ * @param capacity Size of @p packet.
+ * @return size_t Length of the answer, 0 if the packet is not a query to answer.
+ */
+size_t CaptiveDnsServer::buildAnswer(uint8_t* packet, size_t length, size_t capacity) const {
+    if (length < DNS_HEADER_SIZE) return 0;
+
+    uint16_t flags = readU16(packet + 2);
+    bool is_query = (flags & 0x8000) == 0;
+    uint8_t opcode = (flags >> 11) & 0x0F;
+    if (!is_query || opcode != 0 || readU16(packet + 4) == 0) return 0;
+
+    size_t pos = DNS_HEADER_SIZE;
+    while (pos < length && packet[pos] != 0) {
+        if ((packet[pos] & 0xC0) != 0) return 0;
+        pos += 1 + packet[pos];
+    }
+    pos++;
+    if (pos + 4 > length) return 0;
+    uint16_t qtype = readU16(packet + pos);
+    uint16_t qclass = readU16(packet + pos + 2);
+    pos += 4;
+
+    bool answer = (qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY) && qclass == DNS_CLASS_IN;
+    if (answer && pos + DNS_ANSWER_SIZE > capacity) return 0;
+
+    writeU16(packet + 2, 0x8000 | 0x0400 | (flags & 0x0100));  // QR, AA, copy RD; RCODE 0
+    writeU16(packet + 4, 1);
+    writeU16(packet + 6, answer ? 1 : 0);
+    writeU16(packet + 8, 0);
+    writeU16(packet + 10, 0);
+    if (!answer) return pos;
+
+    uint8_t* record = packet + pos;
+    writeU16(record, 0xC000 | DNS_HEADER_SIZE);  // pointer to the question name
+    writeU16(record + 2, DNS_TYPE_A);
+    writeU16(record + 4, DNS_CLASS_IN);
+    writeU16(record + 6, (uint16_t) (DNS_ANSWER_TTL_S >> 16));
+    writeU16(record + 8, (uint16_t) DNS_ANSWER_TTL_S);
+    writeU16(record + 10, 4);
+    memcpy(record + 12, &m_address.addr, 4);
+    return pos + DNS_ANSWER_SIZE;
+}
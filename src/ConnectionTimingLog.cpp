@@ -0,0 +1,160 @@
+/**
+ * @file ConnectionTimingLog.cpp
+ * @brief Implementation of the ConnectionTimingLog class recording the phases of connection attempts.
+ */
+
+#include "ConnectionTimingLog.h"
+
+/** @brief Logging tag for the ConnectionTimingLog class. */
+static const char* TAG = "ConnTiming";
+
+/**
+ * @brief Constructs an empty ConnectionTimingLog object.
+ */
+ConnectionTimingLog::ConnectionTimingLog() :
+    m_records{},
+    m_sequence(0),
+    m_pending_scan_ms(0),
+    m_open(false),
+    m_associated_us(0),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+/**
+ * @brief Records the duration of a scan, attributed to the next attempt.
+ *
+ * @param duration_ms Scan duration.
+ */
+void ConnectionTimingLog::recordScan(uint32_t duration_ms) {
+    portENTER_CRITICAL(&m_lock);
+    m_pending_scan_ms = duration_ms;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Opens a new record, overwriting the oldest one when the buffer is full.
+ *
+ * An attempt still open at this point (e.g. superseded by a mode switch) is closed as
+ * failed with WIFI_REASON_UNSPECIFIED.
+ *
+ * @param kind How the attempt was started.
+ */
+void ConnectionTimingLog::beginAttempt(Kind kind) {
+    if (m_open) close(WIFI_REASON_UNSPECIFIED);
+
+    portENTER_CRITICAL(&m_lock);
+    Record& record = m_records[m_sequence % CAPACITY];
+    record = {};
+    record.sequence = ++m_sequence;
+    record.started_us = esp_timer_get_time();
+    record.scan_ms = m_pending_scan_ms;
+    record.kind = kind;
+    record.result = RESULT_PENDING;
+    m_pending_scan_ms = 0;
+    m_associated_us = 0;
+    m_open = true;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Marks the end of the association phase of the open attempt.
+ *
+ * @param channel Channel of the association.
+ */
+void ConnectionTimingLog::onAssociated(uint8_t channel) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&m_lock);
+    if (m_open && m_associated_us == 0) {
+        Record& record = m_records[(m_sequence - 1) % CAPACITY];
+        record.associate_ms = (uint32_t) ((now_us - record.started_us) / 1000);
+        record.channel = channel;
+        m_associated_us = now_us;
+    }
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Closes the open attempt as successful.
+ */
+void ConnectionTimingLog::onGotIp() {
+    close(RESULT_SUCCESS);
+}
+
+/**
+ * @brief Closes the open attempt as failed.
+ *
+ * @param reason Disconnect reason code.
+ */
+void ConnectionTimingLog::onFailed(uint8_t reason) {
+    close(reason == RESULT_SUCCESS ? (uint8_t) WIFI_REASON_UNSPECIFIED : reason);
+}
+
+/**
+ * @brief Copies the recorded attempts, newest first.
+ *
+ * @param out Output array.
+ * @param max Capacity of @p out.
+ * @return size_t Number of records written.
+ */
+size_t ConnectionTimingLog::snapshot(Record* out, size_t max) const {
+    portENTER_CRITICAL(&m_lock);
+    size_t available = m_sequence < CAPACITY ? m_sequence : CAPACITY;
+    size_t count = available < max ? available : max;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = m_records[(m_sequence - 1 - i) % CAPACITY];
+    }
+    portEXIT_CRITICAL(&m_lock);
+    return count;
+}
+
+/**
+ * @brief Returns a printable name of an attempt kind.
+ *
+ * @param kind The kind.
+ * @return const char* Static string.
+ */
+const char* ConnectionTimingLog::toString(Kind kind) {
+    switch (kind) {
+        case Kind::Candidate:   return "candidate";
+        case Kind::FastConnect: return "fast";
+        case Kind::Retry:       return "retry";
+        case Kind::Validation:  return "validation";
+    }
+    return "?";
+}
+
+/**
+ * @brief Closes the open attempt and logs its phases.
+ *
+ * Only the first outcome counts; a later disconnect of an established link leaves the
+ * record untouched.
+ *
+ * @param result RESULT_SUCCESS or the disconnect reason.
+ */
+void ConnectionTimingLog::close(uint8_t result) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&m_lock);
+    if (!m_open) {
+        portEXIT_CRITICAL(&m_lock);
+        return;
+    }
+    Record& record = m_records[(m_sequence - 1) % CAPACITY];
+    record.total_ms = (uint32_t) ((now_us - record.started_us) / 1000);
+    if (result == RESULT_SUCCESS && m_associated_us != 0) {
+        record.dhcp_ms = (uint32_t) ((now_us - m_associated_us) / 1000);
+    }
+    record.result = result;
+    m_open = false;
+    Record copy = record;
+    portEXIT_CRITICAL(&m_lock);
+
+    char outcome[24];
+    if (result == RESULT_SUCCESS) {
+        snprintf(outcome, sizeof(outcome), "succeeded");
+    } else {
+        snprintf(outcome, sizeof(outcome), "failed (reason %u)", result);
+    }
+    ESP_LOGI(TAG, "Attempt #%" PRIu32 " (%s) %s: scan %" PRIu32 " ms, associate %" PRIu32 " ms, dhcp %" PRIu32 " ms, total %" PRIu32 " ms",
+             copy.sequence, toString(copy.kind), outcome, copy.scan_ms, copy.associate_ms, copy.dhcp_ms, copy.total_ms);
+}
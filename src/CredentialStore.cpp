@@ -0,0 +1,317 @@
+/**
+ * @file CredentialStore.cpp
+ * @brief Implementation of the CredentialStore class for persisting multiple Wi-Fi networks.
+ */
+
+#include "CredentialStore.h"
+#include <cstring>
+#include <algorithm>
+
+/** @brief Logging tag for the CredentialStore class. */
+static const char* TAG = "CredentialStore";
+
+/**
+ * @brief Constructs an empty CredentialStore object.
+ */
+CredentialStore::CredentialStore() :
+    m_networks{},
+    m_used{},
+    m_success_seq(0),
+    m_mutex(xSemaphoreCreateRecursiveMutex())
+{
+}
+
+/**
+ * @brief Destroys the CredentialStore object and its mutex.
+ */
+CredentialStore::~CredentialStore() {
+    if (m_mutex) vSemaphoreDelete(m_mutex);
+}
+
+/**
+ * @brief Loads the table from NVS, migrating the legacy single-network keys if present.
+ *
+ * @return esp_err_t ESP_OK on success (also when the table is empty), error code otherwise.
+ */
+esp_err_t CredentialStore::load() {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return err;
+
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        char key[8];
+        entryKey(i, key);
+        size_t required_size = sizeof(Network);
+        m_used[i] = nvs_get_blob(nvs_handle, key, &m_networks[i], &required_size) == ESP_OK &&
+                    required_size == sizeof(Network);
+    }
+    nvs_get_u32(nvs_handle, NVS_KEY_NET_SEQ, &m_success_seq);
+
+    migrateLegacy(nvs_handle);
+    xSemaphoreGiveRecursive(m_mutex);
+    nvs_close(nvs_handle);
+
+    ESP_LOGI(TAG, "Loaded %d stored network(s)", (int) size());
+    return ESP_OK;
+}
+
+/**
+ * @brief Returns the number of stored networks.
+ *
+ * @return size_t Number of used entries.
+ */
+size_t CredentialStore::size() const {
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    size_t count = std::count(m_used, m_used + CAPACITY, true);
+    xSemaphoreGiveRecursive(m_mutex);
+    return count;
+}
+
+/**
+ * @brief Looks up a network by SSID.
+ *
+ * @param ssid The SSID to look for.
+ * @return int Index of the network, or -1 if not stored.
+ */
+int CredentialStore::indexOf(const char* ssid) const {
+    int index = -1;
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < CAPACITY && index < 0; i++) {
+        if (m_used[i] && strncmp(m_networks[i].ssid, ssid, sizeof(m_networks[i].ssid)) == 0) {
+            index = (int) i;
+        }
+    }
+    xSemaphoreGiveRecursive(m_mutex);
+    return index;
+}
+
+/**
+ * @brief Copies a stored network.
+ *
+ * @param index Index returned by indexOf() or a Candidate.
+ * @return Network Copy of the stored entry.
+ */
+CredentialStore::Network CredentialStore::at(size_t index) const {
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    Network network = m_networks[index];
+    xSemaphoreGiveRecursive(m_mutex);
+    return network;
+}
+
+/**
+ * @brief Inserts a network or replaces the entry with the same SSID.
+ *
+ * @param network The network to store.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t CredentialStore::upsert(const Network& network) {
+    if (network.ssid[0] == '\0') return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    int index = indexOf(network.ssid);
+    if (index < 0) {
+        for (size_t i = 0; i < CAPACITY && index < 0; i++) {
+            if (!m_used[i]) index = (int) i;
+        }
+    }
+    if (index < 0) {
+        index = 0;
+        for (size_t i = 1; i < CAPACITY; i++) {
+            const Network& a = m_networks[i];
+            const Network& b = m_networks[index];
+            if (a.priority < b.priority || (a.priority == b.priority && a.last_success < b.last_success)) {
+                index = (int) i;
+            }
+        }
+        ESP_LOGW(TAG, "Credential table full, evicting '%s'", m_networks[index].ssid);
+    }
+
+    m_networks[index] = network;
+    m_networks[index].ssid[sizeof(network.ssid) - 1] = '\0';
+    m_networks[index].password[sizeof(network.password) - 1] = '\0';
+    m_networks[index].last_success = 0;
+    m_networks[index].lease_valid = 0;
+    m_used[index] = true;
+    esp_err_t err = persist(index);
+    xSemaphoreGiveRecursive(m_mutex);
+    return err;
+}
+
+/**
+ * @brief Records a successful connection to a stored network.
+ *
+ * @param index Index of the network.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t CredentialStore::markSuccess(size_t index) {
+    if (index >= CAPACITY) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (!m_used[index]) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if (m_networks[index].last_success != m_success_seq || m_success_seq == 0) {
+        m_networks[index].last_success = ++m_success_seq;
+
+        nvs_handle_t nvs_handle;
+        err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+        if (err == ESP_OK) {
+            nvs_set_u32(nvs_handle, NVS_KEY_NET_SEQ, m_success_seq);
+            nvs_close(nvs_handle);
+            err = persist(index);
+        }
+    }
+    xSemaphoreGiveRecursive(m_mutex);
+    return err;
+}
+
+/**
+ * @brief Stores a new DHCP lease for a network if it differs from the cached one.
+ *
+ * @param index Index of the network.
+ * @param lease The lease obtained via DHCP.
+ * @param granted time() in seconds when the lease was granted, 0 if unknown.
+ * @param seconds Lease duration in seconds, 0 if unknown.
+ * @return esp_err_t ESP_OK on success or if unchanged, error code otherwise.
+ */
+esp_err_t CredentialStore::updateLease(size_t index, const IpSettings& lease, int64_t granted, uint32_t seconds) {
+    if (index >= CAPACITY) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    Network& network = m_networks[index];
+    if (!m_used[index]) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if (!network.lease_valid || memcmp(&network.lease, &lease, sizeof(lease)) != 0 ||
+               network.lease_granted != granted || network.lease_seconds != seconds) {
+        network.lease = lease;
+        network.lease_valid = 1;
+        network.lease_granted = granted;
+        network.lease_seconds = seconds;
+        err = persist(index);
+    }
+    xSemaphoreGiveRecursive(m_mutex);
+    return err;
+}
+
+/**
+ * @brief Removes every stored network.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t CredentialStore::clear() {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return err;
+
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        char key[8];
+        entryKey(i, key);
+        nvs_erase_key(nvs_handle, key);
+        m_used[i] = false;
+    }
+    nvs_erase_key(nvs_handle, NVS_KEY_NET_SEQ);
+    m_success_seq = 0;
+    xSemaphoreGiveRecursive(m_mutex);
+
+    err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * @brief Ranks the stored networks present in a scan result.
+ *
+ * @param records Scan results.
+ * @param count Number of scan results.
+ * @param out Output array, sorted by descending score.
+ * @param max Capacity of @p out.
+ * @return size_t Number of candidates written.
+ */
+size_t CredentialStore::rank(const wifi_ap_record_t* records, size_t count, Candidate* out, size_t max) const {
+    size_t found = 0;
+
+    xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < CAPACITY && found < max; i++) {
+        if (!m_used[i]) continue;
+
+        const wifi_ap_record_t* best = nullptr;
+        for (size_t r = 0; r < count; r++) {
+            if (strncmp((const char*) records[r].ssid, m_networks[i].ssid, sizeof(m_networks[i].ssid)) == 0 &&
+                (!best || records[r].rssi > best->rssi)) {
+                best = &records[r];
+            }
+        }
+        if (!best) continue;
+
+        const Network& network = m_networks[i];
+        int score = best->rssi + network.priority * CREDENTIAL_PRIORITY_WEIGHT;
+        if (network.last_success != 0) {
+            score += (network.last_success == m_success_seq) ? CREDENTIAL_RECENCY_BONUS : CREDENTIAL_RECENCY_BONUS / 2;
+        }
+
+        Candidate& candidate = out[found++];
+        candidate.index = i;
+        candidate.score = score;
+        candidate.rssi = best->rssi;
+        memcpy(candidate.bssid, best->bssid, sizeof(candidate.bssid));
+        candidate.channel = best->primary;
+    }
+    xSemaphoreGiveRecursive(m_mutex);
+
+    std::sort(out, out + found, [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+    return found;
+}
+
+/**
+ * @brief Writes one entry to NVS. The caller holds @ref m_mutex.
+ *
+ * @param index Index of the entry.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t CredentialStore::persist(size_t index) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) return err;
+
+    char key[8];
+    entryKey(index, key);
+    err = nvs_set_blob(nvs_handle, key, &m_networks[index], sizeof(Network));
+    if (err == ESP_OK) err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    return err;
+}
+
+/**
+ * @brief Imports the legacy single-network keys into the table and erases them. The caller holds @ref m_mutex.
+ *
+ * @param nvs_handle Handle opened read-write on NVS_NAMESPACE.
+ */
+void CredentialStore::migrateLegacy(nvs_handle_t nvs_handle) {
+    Network network = {};
+    size_t required_size = sizeof(network.ssid);
+    if (nvs_get_str(nvs_handle, NVS_KEY_WIFI_SSID, network.ssid, &required_size) != ESP_OK) return;
+
+    required_size = sizeof(network.password);
+    nvs_get_str(nvs_handle, NVS_KEY_WIFI_PASS, network.password, &required_size);
+
+    if (indexOf(network.ssid) < 0 && upsert(network) == ESP_OK) {
+        ESP_LOGI(TAG, "Migrated legacy credentials for '%s'", network.ssid);
+    }
+
+    nvs_erase_key(nvs_handle, NVS_KEY_WIFI_SSID);
+    nvs_erase_key(nvs_handle, NVS_KEY_WIFI_PASS);
+    nvs_commit(nvs_handle);
+}
+
+/**
+ * @brief Builds the NVS key of an entry.
+ *
+ * @param index Index of the entry.
+ * @param key Output buffer of at least 8 bytes.
+ */
+void CredentialStore::entryKey(size_t index, char* key) {
+    snprintf(key, 8, NVS_KEY_NET_PREFIX "%d", (int) index);
+}
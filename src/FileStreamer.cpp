@@ -0,0 +1,179 @@
+/**
+ * @file FileStreamer.cpp
+ * @brief Implementation of the FileStreamer class sending files as Content-Length responses.
+ */
+
+#include "FileStreamer.h"
+#include <cstring>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** @brief Logging tag for the FileStreamer class. */
+static const char* TAG = "FileStreamer";
+
+static_assert(FILE_STREAM_CHUNK_SIZE <= FILE_STREAM_BUFFER_SIZE, "Chunks must fit the buffer");
+
+/**
+ * @brief Constructs a FileStreamer without a buffer and with the FILE_STREAM_CHUNK_SIZE chunk size.
+ */
+FileStreamer::FileStreamer() :
+    m_buffer(nullptr),
+    m_chunk_size(FILE_STREAM_CHUNK_SIZE),
+    m_sweep_next(0),
+    m_throughput{},
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+/**
+ * @brief Frees the buffer.
+ */
+FileStreamer::~FileStreamer() {
+    if (m_buffer) heap_caps_free(m_buffer);
+}
+
+/**
+ * @brief Sends a whole file as the complete response.
+ *
+ * @param req HTTP request handle.
+ * @param filepath Absolute path of the file.
+ * @param response Status line and headers.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the file cannot be opened, error code otherwise.
+ */
+esp_err_t FileStreamer::sendFile(httpd_req_t* req, const char* filepath, const Response& response) {
+    int fd = open(filepath, O_RDONLY, 0);
+    if (fd == -1) return ESP_ERR_NOT_FOUND;
+
+    struct stat st;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (fstat(fd, &st) == 0) {
+        ret = stream(req, fd, 0, (size_t) st.st_size, response);
+    }
+    close(fd);
+    return ret;
+}
+
+/**
+ * @brief Sends a byte range of an open file as the complete response.
+ *
+ * Writes the status line and headers with Content-Length, then reads and sends the body one
+ * chunk at a time through the buffer, allocating it on first use.
+ *
+ * @param req HTTP request handle.
+ * @param fd Open file; not closed.
+ * @param offset First byte to send.
+ * @param length Number of bytes to send; the Content-Length.
+ * @param response Status line and headers.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the buffer cannot be allocated, error code otherwise.
+ */
+esp_err_t FileStreamer::stream(httpd_req_t* req, int fd, size_t offset, size_t length, const Response& response) {
+    if (!m_buffer) {
+        m_buffer = static_cast<uint8_t*>(heap_caps_malloc(FILE_STREAM_BUFFER_SIZE, MALLOC_CAP_8BIT));
+        if (!m_buffer) {
+            ESP_LOGE(TAG, "Failed to allocate a %u-byte buffer", (unsigned) FILE_STREAM_BUFFER_SIZE);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    uint8_t* buffer = m_buffer;
+
+    portENTER_CRITICAL(&m_lock);
+    size_t chunk_size = m_chunk_size;
+#if FILE_STREAM_SWEEP
+    chunk_size = SWEEP_SIZES[m_sweep_next];
+    m_sweep_next = (m_sweep_next + 1) % SWEEP_COUNT;
+#endif
+    portEXIT_CRITICAL(&m_lock);
+    if (chunk_size > FILE_STREAM_BUFFER_SIZE) chunk_size = FILE_STREAM_BUFFER_SIZE;
+
+    // The header block is assembled in the body buffer; it is sent before the first read.
+    char* header = reinterpret_cast<char*>(buffer);
+    size_t capacity = FILE_STREAM_BUFFER_SIZE;
+    int used = snprintf(header, capacity, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n",
+                        response.status, response.type, (unsigned) length);
+    auto append = [&](const char* name, const char* value) {
+        if (value && used > 0 && (size_t) used < capacity) {
+            used += snprintf(header + used, capacity - used, "%s: %s\r\n", name, value);
+        }
+    };
+    append("Content-Encoding", response.encoding);
+    append("Content-Range", response.content_range);
+    append("Cache-Control", response.cache_control);
+    append("ETag", response.etag);
+    append("Accept-Ranges", response.accept_ranges ? "bytes" : nullptr);
+    append("Vary", response.vary_encoding ? "Accept-Encoding" : nullptr);
+    if (used > 0 && (size_t) used < capacity) used += snprintf(header + used, capacity - used, "\r\n");
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = used > 0 && (size_t) used < capacity ? sendAll(req, header, used) : ESP_FAIL;
+    if (ret == ESP_OK && offset > 0 && lseek(fd, (off_t) offset, SEEK_SET) < 0) ret = ESP_FAIL;
+
+    size_t remaining = length;
+    while (ret == ESP_OK && remaining > 0) {
+        ssize_t bytes_read = read(fd, buffer, remaining < chunk_size ? remaining : chunk_size);
+        if (bytes_read <= 0) {
+            // The promised Content-Length can no longer be met; the connection must not be reused.
+            ESP_LOGE(TAG, "File ended %u bytes early", (unsigned) remaining);
+            ret = ESP_FAIL;
+            break;
+        }
+        ret = sendAll(req, reinterpret_cast<const char*>(buffer), (size_t) bytes_read);
+        remaining -= (size_t) bytes_read;
+    }
+    int64_t duration_us = esp_timer_get_time() - start_us;
+
+    if (ret == ESP_OK) {
+        size_t bucket = 0;
+        while (bucket + 1 < SWEEP_COUNT && SWEEP_SIZES[bucket + 1] <= chunk_size) bucket++;
+        portENTER_CRITICAL(&m_lock);
+        Throughput& throughput = m_throughput[bucket];
+        throughput.responses++;
+        throughput.bytes += (uint32_t) length;
+        throughput.us += (uint64_t) duration_us;
+        portEXIT_CRITICAL(&m_lock);
+        ESP_LOGD(TAG, "Streamed %u bytes in %u-byte chunks in %" PRId64 " us", (unsigned) length, (unsigned) chunk_size, duration_us);
+    }
+    return ret;
+}
+
+/**
+ * @brief Sets the chunk size of later responses.
+ *
+ * @param size Bytes per read and send, clamped to 1..FILE_STREAM_BUFFER_SIZE.
+ */
+void FileStreamer::setChunkSize(size_t size) {
+    if (size == 0) size = 1;
+    if (size > FILE_STREAM_BUFFER_SIZE) size = FILE_STREAM_BUFFER_SIZE;
+    portENTER_CRITICAL(&m_lock);
+    m_chunk_size = size;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Copies the throughput totals, indexed like SWEEP_SIZES.
+ *
+ * @param out Output array of SWEEP_COUNT entries.
+ */
+void FileStreamer::getThroughput(Throughput* out) const {
+    portENTER_CRITICAL(&m_lock);
+    memcpy(out, m_throughput, sizeof(m_throughput));
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Sends all bytes on the request's socket.
+ *
+ * @param req HTTP request handle.
+ * @param data Bytes to send.
+ * @param length Number of bytes.
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if the socket failed.
+ */
+esp_err_t FileStreamer::sendAll(httpd_req_t* req, const char* data, size_t length) {
+    while (length > 0) {
+        int sent = httpd_send(req, data, length);
+        if (sent <= 0) return ESP_FAIL;
+        data += sent;
+        length -= (size_t) sent;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file FlashAssetStore.cpp
+ * @brief Implementation of the FlashAssetStore class serving assets from a memory-mapped partition.
+ */
+
+#include "FlashAssetStore.h"
+#include "AssetCache.h"
+#include "StaticFileServer.h"
+#include <cstring>
+
+/** @brief Logging tag for the FlashAssetStore class. */
+static const char* TAG = "FlashAssets";
+
+/**
+ * @brief Constructs an unmapped FlashAssetStore object.
+ */
+FlashAssetStore::FlashAssetStore() :
+    m_image(nullptr),
+    m_entries(nullptr),
+    m_count(0),
+    m_mmap(0),
+    m_stats{},
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+/**
+ * @brief Unmaps the partition.
+ */
+FlashAssetStore::~FlashAssetStore() {
+    if (m_image) esp_partition_munmap(m_mmap);
+}
+
+/**
+ * @brief Maps the asset partition and validates the image. Idempotent.
+ *
+ * The whole partition is mapped, so every entry can be sent without further flash access
+ * beyond the cache fills on read.
+ *
+ * @return esp_err_t ESP_OK if the image is mapped, error code otherwise.
+ */
+esp_err_t FlashAssetStore::begin() {
+    if (m_image) return ESP_OK;
+
+    const esp_partition_t* partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t) FLASH_ASSETS_PARTITION_SUBTYPE, FLASH_ASSETS_PARTITION_LABEL);
+    if (!partition) {
+        ESP_LOGW(TAG, "Partition '%s' not found", FLASH_ASSETS_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void* mapped = nullptr;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &mapped, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    const uint8_t* image = static_cast<const uint8_t*>(mapped);
+    Header header;
+    memcpy(&header, image, sizeof(header));
+    bool valid = header.magic == MAGIC && header.count <= (partition->size - sizeof(Header)) / sizeof(Entry);
+    const Entry* entries = reinterpret_cast<const Entry*>(image + sizeof(Header));
+    for (uint32_t i = 0; valid && i < header.count; i++) {
+        valid = entries[i].path[sizeof(entries[i].path) - 1] == '\0' &&
+                entries[i].offset <= partition->size && entries[i].size <= partition->size - entries[i].offset;
+    }
+    if (!valid) {
+        ESP_LOGW(TAG, "No valid asset image in '%s'", FLASH_ASSETS_PARTITION_LABEL);
+        esp_partition_munmap(handle);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    m_entries = entries;
+    m_count = header.count;
+    m_mmap = handle;
+    m_image = image;
+    ESP_LOGI(TAG, "Mapped %" PRIu32 " assets from '%s'", m_count, FLASH_ASSETS_PARTITION_LABEL);
+    return ESP_OK;
+}
+
+/**
+ * @brief Sends an asset as the complete response.
+ *
+ * Sets the content type (from the path), Content-Encoding, Vary, ETag and Cache-Control,
+ * and answers with 304 Not Modified if If-None-Match matches the ETag.
+ *
+ * @param req HTTP request handle.
+ * @param path Request path, e.g. "/index.html"; a query string is ignored.
+ * @return esp_err_t Result of httpd_resp_send(), or ESP_ERR_NOT_FOUND if no acceptable variant exists.
+ */
+esp_err_t FlashAssetStore::send(httpd_req_t* req, const char* path) {
+    if (!m_image) return ESP_ERR_NOT_FOUND;
+
+    size_t length = strcspn(path, "?#");
+    bool gzip = AssetCache::acceptsGzip(req);
+    for (uint32_t i = 0; i < m_count; i++) {
+        const Entry& entry = m_entries[i];
+        if (strncmp(entry.path, path, length) != 0 || entry.path[length] != '\0') continue;
+        if ((entry.flags & FLAG_GZIP) && !gzip) continue;
+
+        // Header values are referenced until the response is sent.
+        char etag[11];
+        snprintf(etag, sizeof(etag), "\"%08" PRIx32 "\"", entry.hash);
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_set_hdr(req, "Cache-Control", ASSET_CACHE_CONTROL);
+        if (AssetCache::matchesIfNoneMatch(req, etag)) {
+            portENTER_CRITICAL(&m_lock);
+            m_stats.hits++;
+            m_stats.not_modified++;
+            portEXIT_CRITICAL(&m_lock);
+            httpd_resp_set_status(req, "304 Not Modified");
+            return httpd_resp_send(req, NULL, 0);
+        }
+
+        httpd_resp_set_type(req, StaticFileServer::mimeType(entry.path));
+        if (entry.flags & FLAG_GZIP) httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t ret = httpd_resp_send(req, (const char*) m_image + entry.offset, entry.size);
+        int64_t send_us = esp_timer_get_time() - start_us;
+
+        portENTER_CRITICAL(&m_lock);
+        m_stats.hits++;
+        if (ret == ESP_OK) {
+            m_stats.bytes_sent += entry.size;
+            m_stats.send_us += (uint64_t) send_us;
+        }
+        portEXIT_CRITICAL(&m_lock);
+        return ret;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Retrieves a copy of the counters.
+ *
+ * @return Stats Current counters.
+ */
+FlashAssetStore::Stats FlashAssetStore::getStats() const {
+    portENTER_CRITICAL(&m_lock);
+    Stats stats = m_stats;
+    portEXIT_CRITICAL(&m_lock);
+    return stats;
+}
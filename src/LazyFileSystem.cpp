@@ -0,0 +1,94 @@
+/**
+ * @file LazyFileSystem.cpp
+ * @brief Implementation of the LazyFileSystem class mounting LittleFS on first use.
+ */
+
+#include "LazyFileSystem.h"
+
+/** @brief Logging tag for the LazyFileSystem class. */
+static const char* TAG = "LazyFS";
+
+/**
+ * @brief Constructs an unmounted LazyFileSystem object.
+ */
+LazyFileSystem::LazyFileSystem() :
+    m_mutex(xSemaphoreCreateMutex()),
+    m_mounted(false)
+{
+}
+
+/**
+ * @brief Destroys the LazyFileSystem object and its mutex. The filesystem stays mounted.
+ */
+LazyFileSystem::~LazyFileSystem() {
+    if (m_mutex) vSemaphoreDelete(m_mutex);
+}
+
+/**
+ * @brief Mounts the filesystem at LFS_BASE_PATH unless it is mounted already.
+ *
+ * @return esp_err_t ESP_OK if the filesystem is mounted, error code otherwise.
+ */
+esp_err_t LazyFileSystem::ensureMounted() {
+    // Acquire pairs with the release in mount(), so a caller that skips the mutex also sees
+    // the VFS registration.
+    if (m_mounted.load(std::memory_order_acquire)) return ESP_OK;
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    esp_err_t ret = m_mounted.load(std::memory_order_relaxed) ? ESP_OK : mount();
+    xSemaphoreGive(m_mutex);
+    return ret;
+}
+
+/**
+ * @brief Checks whether the filesystem has been mounted.
+ *
+ * @return true if mounted, false otherwise.
+ */
+bool LazyFileSystem::isMounted() const {
+    return m_mounted.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Registers LittleFS with the VFS and logs the partition usage.
+ *
+ * Uses the base path and partition label defined in config.h and formats the partition if
+ * it cannot be mounted.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t LazyFileSystem::mount() {
+    ESP_LOGI(TAG, "Mounting LittleFS...");
+    int64_t start_us = esp_timer_get_time();
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = LFS_BASE_PATH,
+        .partition_label = LFS_PARTITION_LABEL,
+        .partition = NULL,
+        .format_if_mount_failed = true,
+        .read_only = false,
+        .dont_mount = false,
+        .grow_on_mount = false,
+    };
+
+    esp_err_t ret = esp_vfs_littlefs_register(&conf);
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find LittleFS partition. Ensure '%s' exists in partition_custom.csv", LFS_PARTITION_LABEL);
+        } else {
+            ESP_LOGE(TAG, "Failed to initialize LittleFS (%s)", esp_err_to_name(ret));
+        }
+        return ret;
+    }
+    m_mounted.store(true, std::memory_order_release);
+
+    size_t total = 0, used = 0;
+    if (esp_littlefs_info(conf.partition_label, &total, &used) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to retrieve LittleFS partition info");
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %u, used: %u", (unsigned) total, (unsigned) used);
+    }
+    ESP_LOGI(TAG, "LittleFS mounted at %s in %" PRId64 " ms", LFS_BASE_PATH, (esp_timer_get_time() - start_us) / 1000);
+    return ESP_OK;
+}
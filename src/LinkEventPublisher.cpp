@@ -0,0 +1,105 @@
+/**
+ * @file LinkEventPublisher.cpp
+ * @brief Implementation of the LinkEventPublisher class delivering connectivity events to subscriber queues.
+ */
+
+#include "LinkEventPublisher.h"
+
+/**
+ * @brief Constructs a LinkEventPublisher object without subscribers.
+ */
+LinkEventPublisher::LinkEventPublisher() :
+    m_queues{},
+    m_dropped(0),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+/**
+ * @brief Adds a subscriber queue.
+ *
+ * @param queue Queue created with an item size of sizeof(LinkEvent).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if all slots are taken.
+ */
+esp_err_t LinkEventPublisher::subscribe(QueueHandle_t queue) {
+    if (!queue) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (!m_queues[i]) {
+            m_queues[i] = queue;
+            err = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_lock);
+    return err;
+}
+
+/**
+ * @brief Removes a subscriber queue.
+ *
+ * @param queue Queue passed to subscribe().
+ */
+void LinkEventPublisher::unsubscribe(QueueHandle_t queue) {
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (m_queues[i] == queue) m_queues[i] = nullptr;
+    }
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Delivers an event to every subscriber without blocking.
+ *
+ * The slot table is copied under the lock and the queues are fed outside of it.
+ *
+ * @param event The event.
+ */
+void LinkEventPublisher::publish(const LinkEvent& event) {
+    QueueHandle_t queues[CAPACITY];
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = 0; i < CAPACITY; i++) {
+        queues[i] = m_queues[i];
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < CAPACITY; i++) {
+        if (queues[i] && xQueueSend(queues[i], &event, 0) != pdTRUE) dropped++;
+    }
+    if (dropped) {
+        portENTER_CRITICAL(&m_lock);
+        m_dropped += dropped;
+        portEXIT_CRITICAL(&m_lock);
+    }
+}
+
+/**
+ * @brief Returns the number of events dropped because a subscriber queue was full.
+ *
+ * @return uint32_t Dropped events since boot.
+ */
+uint32_t LinkEventPublisher::droppedEvents() const {
+    portENTER_CRITICAL(&m_lock);
+    uint32_t dropped = m_dropped;
+    portEXIT_CRITICAL(&m_lock);
+    return dropped;
+}
+
+/**
+ * @brief Returns a printable name of an event type.
+ *
+ * @param type The type.
+ * @return const char* Static string.
+ */
+const char* LinkEventPublisher::toString(Type type) {
+    switch (type) {
+        case Type::Up:        return "Up";
+        case Type::Down:      return "Down";
+        case Type::IpChanged: return "IpChanged";
+        case Type::Roamed:    return "Roamed";
+    }
+    return "?";
+}
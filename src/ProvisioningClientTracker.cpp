@@ -0,0 +1,216 @@
+/**
+ * @file ProvisioningClientTracker.cpp
+ * @brief Implementation of the ProvisioningClientTracker class enforcing per-client fairness on the provisioning server.
+ */
+
+#include "ProvisioningClientTracker.h"
+
+/** @brief Logging tag for the ProvisioningClientTracker class. */
+static const char* TAG = "ProvClients";
+
+/**
+ * @brief Constructs an empty ProvisioningClientTracker object.
+ */
+ProvisioningClientTracker::ProvisioningClientTracker() :
+    m_sessions{},
+    m_stations{},
+    m_stats{},
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    reset();
+}
+
+/**
+ * @brief Forgets all sessions, stations and counters.
+ */
+void ProvisioningClientTracker::reset() {
+    portENTER_CRITICAL(&m_lock);
+    for (Session& session : m_sessions) {
+        session = {};
+        session.sockfd = -1;
+    }
+    for (Station& station : m_stations) {
+        station = {};
+    }
+    m_stats = {};
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Registers a new session.
+ *
+ * The station is looked up by address, so closing and reopening sessions does not reset its
+ * request budget; it is created on its first session.
+ *
+ * @param sockfd Socket of the session.
+ * @param address IPv4 address of the peer (network byte order).
+ * @return true if the session is tracked, false if a table is full.
+ */
+bool ProvisioningClientTracker::onOpen(int sockfd, uint32_t address) {
+    int64_t now_us = esp_timer_get_time();
+    bool tracked = false;
+
+    portENTER_CRITICAL(&m_lock);
+    Session* session = findSessionLocked(-1);
+    int station_index = -1;
+    int free_station = -1;
+    for (size_t i = 0; i < STATION_CAPACITY; i++) {
+        if (m_stations[i].address == address) {
+            station_index = (int) i;
+            break;
+        }
+        // Prefer never-used slots so a station reconnecting soon keeps its budget window.
+        if (m_stations[i].sessions == 0 && (free_station < 0 || m_stations[i].address == 0)) free_station = (int) i;
+    }
+    if (station_index < 0 && free_station >= 0) {
+        station_index = free_station;
+        Station& station = m_stations[station_index];
+        station = {};
+        station.address = address;
+        station.window_start_us = now_us;
+    }
+    if (session && station_index >= 0) {
+        session->sockfd = sockfd;
+        session->station = (uint8_t) station_index;
+        session->last_activity_us = now_us;
+        m_stations[station_index].sessions++;
+        tracked = true;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (!tracked) ESP_LOGW(TAG, "No slot for session %d", sockfd);
+    return tracked;
+}
+
+/**
+ * @brief Unregisters a session.
+ *
+ * @param sockfd Socket of the session.
+ */
+void ProvisioningClientTracker::onClose(int sockfd) {
+    portENTER_CRITICAL(&m_lock);
+    Session* session = findSessionLocked(sockfd);
+    if (session) {
+        Station& station = m_stations[session->station];
+        if (station.sessions > 0) station.sessions--;
+        session->sockfd = -1;
+    }
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Records a request on a session and charges it to the station's budget.
+ *
+ * The budget is PROV_CLIENT_REQUEST_BUDGET requests per PROV_CLIENT_BUDGET_WINDOW_MS.
+ * Requests on sessions that are not tracked are admitted.
+ *
+ * @param sockfd Socket of the session.
+ * @return true if the request may be served, false if the station exceeded its budget.
+ */
+bool ProvisioningClientTracker::admit(int sockfd) {
+    int64_t now_us = esp_timer_get_time();
+    bool admitted = true;
+    uint32_t address = 0;
+
+    portENTER_CRITICAL(&m_lock);
+    Session* session = findSessionLocked(sockfd);
+    if (session) {
+        session->last_activity_us = now_us;
+        Station& station = m_stations[session->station];
+        if (now_us - station.window_start_us >= (int64_t) PROV_CLIENT_BUDGET_WINDOW_MS * 1000) {
+            station.window_start_us = now_us;
+            station.requests = 0;
+        }
+        if (station.requests >= PROV_CLIENT_REQUEST_BUDGET) {
+            admitted = false;
+            address = station.address;
+        } else {
+            station.requests++;
+        }
+    }
+    if (admitted) {
+        m_stats.requests++;
+    } else {
+        m_stats.rejected++;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (!admitted) {
+        esp_ip4_addr_t ip = {address};
+        ESP_LOGW(TAG, "Request budget exceeded by " IPSTR, IP2STR(&ip));
+    }
+    return admitted;
+}
+
+/**
+ * @brief Collects sessions without a request for PROV_CLIENT_IDLE_TIMEOUT_MS and counts them as evicted.
+ *
+ * The sessions stay tracked until the server reports them closed through onClose().
+ *
+ * @param out Output array of sockets to close.
+ * @param max Capacity of @p out.
+ * @return size_t Number of sockets written.
+ */
+size_t ProvisioningClientTracker::collectIdle(int* out, size_t max) {
+    int64_t now_us = esp_timer_get_time();
+    size_t count = 0;
+
+    portENTER_CRITICAL(&m_lock);
+    for (Session& session : m_sessions) {
+        if (count >= max) break;
+        if (session.sockfd < 0) continue;
+        if (now_us - session.last_activity_us >= (int64_t) PROV_CLIENT_IDLE_TIMEOUT_MS * 1000) {
+            out[count++] = session.sockfd;
+            session.last_activity_us = now_us;  // do not report it again before it is closed
+        }
+    }
+    m_stats.evicted += count;
+    portEXIT_CRITICAL(&m_lock);
+    return count;
+}
+
+/**
+ * @brief Records the serve time of a page.
+ *
+ * @param duration_us Serve time in microseconds.
+ * @return size_t Number of stations with an open session at the time.
+ */
+size_t ProvisioningClientTracker::recordServe(uint32_t duration_us) {
+    portENTER_CRITICAL(&m_lock);
+    size_t active = 0;
+    for (const Station& station : m_stations) {
+        if (station.sessions > 0) active++;
+    }
+    size_t bucket = active == 0 ? 0 : (active > LATENCY_BUCKETS ? LATENCY_BUCKETS : active) - 1;
+    Latency& latency = m_stats.latency[bucket];
+    latency.count++;
+    latency.total_us += duration_us;
+    if (duration_us > latency.max_us) latency.max_us = duration_us;
+    portEXIT_CRITICAL(&m_lock);
+    return active;
+}
+
+/**
+ * @brief Retrieves a copy of the counters.
+ *
+ * @return Stats Current counters.
+ */
+ProvisioningClientTracker::Stats ProvisioningClientTracker::getStats() const {
+    portENTER_CRITICAL(&m_lock);
+    Stats stats = m_stats;
+    portEXIT_CRITICAL(&m_lock);
+    return stats;
+}
+
+/**
+ * @brief Finds the slot of a session. Lock must be held.
+ *
+ * @param sockfd Socket of the session; -1 finds a free slot.
+ * @return Session* The slot, or null.
+ */
+ProvisioningClientTracker::Session* ProvisioningClientTracker::findSessionLocked(int sockfd) {
+    for (Session& session : m_sessions) {
+        if (session.sockfd == sockfd) return &session;
+    }
+    return nullptr;
+}
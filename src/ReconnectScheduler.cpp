@@ -0,0 +1,269 @@
+/**
+ * @file ReconnectScheduler.cpp
+ * @brief Implementation of the ReconnectScheduler class for timed station reconnection.
+ */
+
+#include "ReconnectScheduler.h"
+#include "config.h"
+
+/** @brief Logging tag for the ReconnectScheduler class. */
+static const char* TAG = "Reconnect";
+
+/**
+ * @brief Disconnect reasons of every category except Transient, which takes all others.
+ *
+ * WIFI_REASON_MIC_FAILURE is left to Transient: it reports a TKIP Michael MIC failure on an
+ * established link (a countermeasure, or a corrupted frame), not a wrong password.
+ */
+static constexpr struct {
+    ReconnectScheduler::Category category;
+    uint8_t reasons[8];
+} CATEGORY_REASONS[] = {
+    {ReconnectScheduler::Category::AuthFailure,
+     {WIFI_REASON_AUTH_FAIL, WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT, WIFI_REASON_HANDSHAKE_TIMEOUT,
+      WIFI_REASON_802_1X_AUTH_FAILED, WIFI_REASON_IE_IN_4WAY_DIFFERS, WIFI_REASON_INVALID_PMKID}},
+    {ReconnectScheduler::Category::NoApFound,
+     {WIFI_REASON_NO_AP_FOUND, WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY,
+      WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD, WIFI_REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD}},
+    {ReconnectScheduler::Category::ApKick,
+     {WIFI_REASON_AUTH_LEAVE, WIFI_REASON_ASSOC_EXPIRE, WIFI_REASON_ASSOC_TOOMANY, WIFI_REASON_NOT_AUTHED,
+      WIFI_REASON_NOT_ASSOCED, WIFI_REASON_BSS_TRANSITION_DISASSOC, WIFI_REASON_AP_TSF_RESET}},
+};
+
+/**
+ * @brief Retry policy per category, indexed by ReconnectScheduler::Category.
+ *
+ * The budget applies until the first successful connection; the minimum delay always applies.
+ */
+static constexpr struct {
+    uint8_t budget;
+    uint32_t min_delay_ms;
+} CATEGORY_POLICIES[] = {
+    {RECONNECT_AUTH_BUDGET, 0},                                  // AuthFailure
+    {RECONNECT_NO_AP_BUDGET, 0},                                 // NoApFound
+    {RECONNECT_TRANSIENT_BUDGET, 0},                             // Transient
+    {RECONNECT_AP_KICK_BUDGET, RECONNECT_AP_KICK_DELAY_MS},      // ApKick
+};
+
+/**
+ * @brief Constructs a new ReconnectScheduler object.
+ *
+ * @param policy Backoff parameters.
+ */
+ReconnectScheduler::ReconnectScheduler(const Policy& policy) :
+    m_policy(policy),
+    m_timer(nullptr),
+    m_on_retry(nullptr),
+    m_on_retry_arg(nullptr),
+    m_budget_used{},
+    m_backoff_step(0),
+    m_ever_connected(false),
+    m_outage_start_us(0),
+    m_stats{},
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    static_assert(sizeof(CATEGORY_POLICIES) / sizeof(CATEGORY_POLICIES[0]) == CATEGORY_COUNT,
+                  "Policy table and category count differ");
+}
+
+/**
+ * @brief Destroys the ReconnectScheduler object and its timer.
+ */
+ReconnectScheduler::~ReconnectScheduler() {
+    if (m_timer) {
+        esp_timer_stop(m_timer);
+        esp_timer_delete(m_timer);
+    }
+}
+
+/**
+ * @brief Creates the backing esp_timer.
+ *
+ * @param on_retry Callback invoked when an attempt is due; if null, esp_wifi_connect() is called directly.
+ * @param arg Argument passed to @p on_retry.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t ReconnectScheduler::init(void (*on_retry)(void*), void* arg) {
+    m_on_retry = on_retry;
+    m_on_retry_arg = arg;
+    if (m_timer) return ESP_OK;
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &timerCallback;
+    timer_args.arg = this;
+    timer_args.name = "reconnect";
+    return esp_timer_create(&timer_args, &m_timer);
+}
+
+/**
+ * @brief Schedules the next reconnection attempt after a disconnect.
+ *
+ * @param reason Disconnect reason from wifi_event_sta_disconnected_t.
+ * @return true if an attempt was scheduled, false if the retry budget of the reason's category is exhausted.
+ */
+bool ReconnectScheduler::schedule(uint8_t reason) {
+    if (!m_timer) return false;
+
+    Category category = classify(reason);
+    size_t slot = (size_t) category;
+    if (!m_ever_connected) {
+        if (m_budget_used[slot] >= CATEGORY_POLICIES[slot].budget) {
+            ESP_LOGW(TAG, "Retry budget exhausted for reason %d (%s)", reason, toString(category));
+            portENTER_CRITICAL(&m_lock);
+            m_stats.last_reason = reason;
+            m_stats.last_category = category;
+            portEXIT_CRITICAL(&m_lock);
+            return false;
+        }
+        m_budget_used[slot]++;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&m_lock);
+    if (m_stats.current_attempts == 0) {
+        m_outage_start_us = now_us;
+    }
+    m_stats.total_attempts++;
+    m_stats.current_attempts++;
+    m_stats.last_reason = reason;
+    m_stats.last_category = category;
+    portEXIT_CRITICAL(&m_lock);
+
+    uint32_t delay_ms = nextDelayMs(CATEGORY_POLICIES[slot].min_delay_ms);
+    m_backoff_step++;
+    ESP_LOGI(TAG, "Disconnected (reason %d, %s), attempt %" PRIu32 " in %" PRIu32 " ms",
+             reason, toString(category), m_stats.current_attempts, delay_ms);
+
+    esp_timer_stop(m_timer);
+    return esp_timer_start_once(m_timer, (uint64_t) delay_ms * 1000) == ESP_OK;
+}
+
+/**
+ * @brief Records a successful connection and resets the backoff.
+ */
+void ReconnectScheduler::onConnected() {
+    esp_timer_stop(m_timer);
+
+    portENTER_CRITICAL(&m_lock);
+    if (m_ever_connected && m_stats.current_attempts > 0) {
+        m_stats.recoveries++;
+        m_stats.last_recovery_attempts = m_stats.current_attempts;
+        m_stats.last_recovery_ms = (esp_timer_get_time() - m_outage_start_us) / 1000;
+    }
+    m_stats.current_attempts = 0;
+    portEXIT_CRITICAL(&m_lock);
+
+    if (m_stats.last_recovery_attempts > 0) {
+        ESP_LOGI(TAG, "Recovered after %" PRIu32 " attempts in %" PRId64 " ms",
+                 m_stats.last_recovery_attempts, m_stats.last_recovery_ms);
+    }
+
+    m_backoff_step = 0;
+    m_ever_connected = true;
+    memset(m_budget_used, 0, sizeof(m_budget_used));
+}
+
+/**
+ * @brief Cancels any pending attempt and forgets budgets and connection history.
+ */
+void ReconnectScheduler::reset() {
+    cancel();
+    m_backoff_step = 0;
+    m_ever_connected = false;
+    memset(m_budget_used, 0, sizeof(m_budget_used));
+
+    portENTER_CRITICAL(&m_lock);
+    m_stats.current_attempts = 0;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Cancels any pending attempt without touching counters.
+ */
+void ReconnectScheduler::cancel() {
+    if (m_timer) esp_timer_stop(m_timer);
+}
+
+/**
+ * @brief Retrieves a copy of the reconnection counters.
+ *
+ * @return Stats Current counters.
+ */
+ReconnectScheduler::Stats ReconnectScheduler::getStats() const {
+    portENTER_CRITICAL(&m_lock);
+    Stats stats = m_stats;
+    portEXIT_CRITICAL(&m_lock);
+    return stats;
+}
+
+/**
+ * @brief Maps a disconnect reason to its category.
+ *
+ * @param reason Disconnect reason code.
+ * @return Category The category; Transient for reasons not listed explicitly.
+ */
+ReconnectScheduler::Category ReconnectScheduler::classify(uint8_t reason) {
+    for (const auto& entry : CATEGORY_REASONS) {
+        for (uint8_t r : entry.reasons) {
+            if (r != 0 && r == reason) return entry.category;
+        }
+    }
+    return Category::Transient;
+}
+
+/**
+ * @brief Returns a printable name of a category.
+ *
+ * @param category The category.
+ * @return const char* Static string.
+ */
+const char* ReconnectScheduler::toString(Category category) {
+    switch (category) {
+        case Category::AuthFailure: return "auth failure";
+        case Category::NoApFound:   return "no AP found";
+        case Category::Transient:   return "transient";
+        case Category::ApKick:      return "AP kick";
+    }
+    return "?";
+}
+
+/**
+ * @brief esp_timer callback that issues the reconnection attempt.
+ *
+ * @param arg Pointer to the ReconnectScheduler instance.
+ */
+void ReconnectScheduler::timerCallback(void* arg) {
+    ReconnectScheduler* self = static_cast<ReconnectScheduler*>(arg);
+    if (self->m_on_retry) {
+        self->m_on_retry(self->m_on_retry_arg);
+        return;
+    }
+
+    esp_err_t err = esp_wifi_connect();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_connect failed (%s)", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Computes the delay for the current attempt including jitter.
+ *
+ * delay = clamp(base * multiplier^step, min_delay, max) +/- jitter_percent.
+ *
+ * @param min_delay_ms Lower bound of the delay before jitter.
+ * @return uint32_t Delay in milliseconds.
+ */
+uint32_t ReconnectScheduler::nextDelayMs(uint32_t min_delay_ms) const {
+    uint64_t delay = m_policy.base_delay_ms;
+    for (uint32_t i = 0; i < m_backoff_step && delay < m_policy.max_delay_ms; i++) {
+        delay *= m_policy.multiplier;
+    }
+    if (delay < min_delay_ms) delay = min_delay_ms;
+    if (delay > m_policy.max_delay_ms) delay = m_policy.max_delay_ms;
+
+    uint32_t jitter = (uint32_t) (delay * m_policy.jitter_percent / 100);
+    if (jitter > 0) {
+        delay = delay - jitter + (esp_random() % (2 * jitter + 1));
+    }
+    return (uint32_t) delay;
+}
@@ -0,0 +1,367 @@
+/**
+ * @file RoamingController.cpp
+ * @brief Implementation of the RoamingController class for moving between access points of one network.
+ */
+
+#include "RoamingController.h"
+#include "config.h"
+#include <cstring>
+#if CONFIG_ESP_WIFI_11KV_SUPPORT
+#include "esp_wnm.h"
+#include "esp_rrm.h"
+#endif
+
+/** @brief Logging tag for the RoamingController class. */
+static const char* TAG = "Roaming";
+
+/** @brief Element ID of an 802.11k Neighbor Report element. */
+static constexpr uint8_t NEIGHBOR_REPORT_EID = 52;
+
+/** @brief Minimum body length of a Neighbor Report element (BSSID, info, class, channel, PHY). */
+static constexpr uint8_t NEIGHBOR_REPORT_MIN_LEN = 13;
+
+/** @brief Offset of the channel number within a Neighbor Report element body. */
+static constexpr uint8_t NEIGHBOR_REPORT_CHANNEL_OFFSET = 11;
+
+/**
+ * @brief Constructs a new RoamingController object, disabled.
+ *
+ * @param policy Roaming parameters.
+ */
+RoamingController::RoamingController(const Policy& policy) :
+    m_policy(policy),
+    m_enabled(false),
+    m_timer(nullptr),
+    m_bssid{},
+    m_associated(false),
+    m_scanning(false),
+    m_btm_tried(false),
+    m_neighbor_tried(false),
+    m_roam_started_us(0),
+    m_trigger_rssi(0),
+    m_stats{},
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+/**
+ * @brief Destroys the RoamingController object and its timer.
+ */
+RoamingController::~RoamingController() {
+    if (m_timer) {
+        esp_timer_stop(m_timer);
+        esp_timer_delete(m_timer);
+    }
+}
+
+/**
+ * @brief Creates the re-arm timer.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t RoamingController::init() {
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &rearmCallback;
+    timer_args.arg = this;
+    timer_args.name = "roam_rearm";
+    return esp_timer_create(&timer_args, &m_timer);
+}
+
+/**
+ * @brief Enables or disables roaming. Takes effect at the next association.
+ *
+ * @param enabled True to enable roaming.
+ */
+void RoamingController::setEnabled(bool enabled) {
+    m_enabled = enabled;
+}
+
+/**
+ * @brief Returns whether roaming is enabled.
+ *
+ * @return true if enabled.
+ */
+bool RoamingController::isEnabled() const {
+    return m_enabled;
+}
+
+/**
+ * @brief Sets the 802.11k/v/r capability flags of a station configuration.
+ *
+ * The flags are advertised only when roaming is enabled; without the matching sdkconfig
+ * options the driver ignores them.
+ *
+ * @param sta The station configuration passed to esp_wifi_set_config().
+ */
+void RoamingController::applyTo(wifi_sta_config_t& sta) const {
+    sta.rm_enabled = m_enabled;
+    sta.btm_enabled = m_enabled;
+    sta.ft_enabled = m_enabled;
+}
+
+/**
+ * @brief Handles WIFI_EVENT_STA_CONNECTED: completes a pending roam and arms the threshold.
+ *
+ * @param bssid BSSID the station associated with.
+ * @return true if the association completed a roam to another BSSID.
+ */
+bool RoamingController::onConnected(const uint8_t* bssid) {
+    bool moved = memcmp(m_bssid, bssid, sizeof(m_bssid)) != 0;
+    memcpy(m_bssid, bssid, sizeof(m_bssid));
+    m_associated = true;
+    if (!m_enabled) return false;
+
+    bool roamed = m_roam_started_us != 0 && moved;
+    if (roamed) {
+        finishRoam(true);
+    } else if (m_roam_started_us == 0) {
+        m_btm_tried = false;
+        m_neighbor_tried = false;
+    }
+    esp_wifi_set_rssi_threshold(m_policy.rssi_threshold);
+    return roamed;
+}
+
+/**
+ * @brief Handles WIFI_EVENT_STA_DISCONNECTED.
+ *
+ * Leaving the old AP during a roam is expected; any other reason ends the roam as failed
+ * and is reported to the caller as a regular link loss.
+ *
+ * @param reason Disconnect reason code.
+ * @return true if the disconnect is part of a roam in progress and must not be treated as a link loss.
+ */
+bool RoamingController::onDisconnected(uint8_t reason) {
+    if (m_scanning) {
+        m_scanning = false;
+        esp_wifi_scan_stop();
+    }
+    if (m_roam_started_us != 0 && (reason == WIFI_REASON_ROAMING || reason == WIFI_REASON_ASSOC_LEAVE)) {
+        return true;
+    }
+    m_associated = false;
+    if (m_roam_started_us != 0) finishRoam(false);
+    return false;
+}
+
+/**
+ * @brief Handles WIFI_EVENT_STA_BSS_RSSI_LOW by starting the next roaming mechanism.
+ *
+ * @param rssi The RSSI reported by the driver.
+ */
+void RoamingController::onRssiLow(int32_t rssi) {
+    if (!m_enabled || !m_associated || m_scanning) return;
+    if (m_roam_started_us != 0) {
+        if (esp_timer_get_time() - m_roam_started_us < (int64_t) m_policy.retrigger_ms * 1000) return;
+        ESP_LOGW(TAG, "Roam was not completed, giving up on it");
+        finishRoam(false);
+    }
+
+    m_trigger_rssi = (int8_t) rssi;
+    portENTER_CRITICAL(&m_lock);
+    m_stats.triggers++;
+    portEXIT_CRITICAL(&m_lock);
+    ESP_LOGI(TAG, "RSSI %d dBm below threshold %d dBm", (int) rssi, m_policy.rssi_threshold);
+    scheduleRearm();
+
+#if CONFIG_ESP_WIFI_11KV_SUPPORT
+    if (!m_btm_tried && esp_wnm_is_btm_supported_connection()) {
+        m_btm_tried = true;
+        if (esp_wnm_send_bss_transition_mgmt_query(REASON_FRAME_LOSS, nullptr, 0) == 0) {
+            portENTER_CRITICAL(&m_lock);
+            m_stats.btm_queries++;
+            m_stats.last_rssi_before = m_trigger_rssi;
+            m_stats.last_rssi_after = 0;
+            portEXIT_CRITICAL(&m_lock);
+            m_roam_started_us = esp_timer_get_time();
+            ESP_LOGI(TAG, "Sent BSS transition query");
+            return;
+        }
+    }
+    if (!m_neighbor_tried && esp_rrm_is_rrm_supported_connection()) {
+        m_neighbor_tried = true;
+        if (esp_rrm_send_neighbor_report_request() == 0) {
+            portENTER_CRITICAL(&m_lock);
+            m_stats.neighbor_requests++;
+            portEXIT_CRITICAL(&m_lock);
+            ESP_LOGI(TAG, "Requested neighbor report");
+            return;
+        }
+    }
+#endif
+    startScan(0);
+}
+
+/**
+ * @brief Handles WIFI_EVENT_STA_NEIGHBOR_REP by scanning the reported channels.
+ *
+ * @param report Dialog token followed by Neighbor Report elements.
+ * @param len Length of @p report.
+ */
+void RoamingController::onNeighborReport(const uint8_t* report, size_t len) {
+    if (!m_enabled || !m_associated || m_scanning || m_roam_started_us != 0) return;
+
+    uint16_t channels = 0;
+    for (size_t pos = 1; pos + 2 <= len && pos + 2 + report[pos + 1] <= len; pos += 2 + report[pos + 1]) {
+        const uint8_t* body = &report[pos + 2];
+        if (report[pos] != NEIGHBOR_REPORT_EID || report[pos + 1] < NEIGHBOR_REPORT_MIN_LEN) continue;
+        uint8_t channel = body[NEIGHBOR_REPORT_CHANNEL_OFFSET];
+        if (channel >= 1 && channel <= 14) channels |= (uint16_t) (1U << channel);
+    }
+    ESP_LOGI(TAG, "Neighbor report channel mask 0x%04x", channels);
+    startScan(channels);
+}
+
+/**
+ * @brief Handles WIFI_EVENT_SCAN_DONE of a roaming scan and roams if a better BSSID was found.
+ *
+ * Records are read one at a time; the best one is a different BSSID of the current SSID whose
+ * RSSI exceeds the current one by at least @ref Policy::min_rssi_gain.
+ *
+ * @return true if the scan belonged to the controller, false otherwise.
+ */
+bool RoamingController::onScanDone() {
+    if (!m_scanning) return false;
+    m_scanning = false;
+
+    wifi_ap_record_t current;
+    bool associated = esp_wifi_sta_get_ap_info(&current) == ESP_OK;
+
+    wifi_ap_record_t best = {};
+    bool found = false;
+    wifi_ap_record_t record;
+    while (associated && esp_wifi_scan_get_ap_record(&record) == ESP_OK) {
+        if (memcmp(record.bssid, current.bssid, sizeof(record.bssid)) == 0) continue;
+        if (strncmp((const char*) record.ssid, (const char*) current.ssid, sizeof(record.ssid)) != 0) continue;
+        if (record.rssi < current.rssi + m_policy.min_rssi_gain) continue;
+        if (!found || record.rssi > best.rssi) {
+            best = record;
+            found = true;
+        }
+    }
+    esp_wifi_clear_ap_list();
+
+    if (!associated) return true;
+    if (!found) {
+        ESP_LOGI(TAG, "No better access point than " MACSTR " (%d dBm)", MAC2STR(current.bssid), current.rssi);
+        return true;
+    }
+    roamTo(best);
+    return true;
+}
+
+/**
+ * @brief Retrieves a copy of the roaming counters.
+ *
+ * @return Stats Current counters.
+ */
+RoamingController::Stats RoamingController::getStats() const {
+    portENTER_CRITICAL(&m_lock);
+    Stats stats = m_stats;
+    portEXIT_CRITICAL(&m_lock);
+    return stats;
+}
+
+/**
+ * @brief Starts a background scan for the current SSID.
+ *
+ * @param channels 2.4 GHz channel bitmap (bit n = channel n), or 0 for all channels.
+ */
+void RoamingController::startScan(uint16_t channels) {
+    wifi_config_t config = {};
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK) return;
+
+    wifi_scan_config_t scan_config = {};
+    scan_config.ssid = config.sta.ssid;
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.min = SCAN_CHANNEL_DWELL_MS;
+    scan_config.scan_time.active.max = SCAN_CHANNEL_DWELL_MS;
+    scan_config.home_chan_dwell_time = SCAN_HOME_CHANNEL_DWELL_MS;
+    scan_config.channel_bitmap.ghz_2_channels = channels;
+
+    m_scanning = true;
+    esp_err_t err = esp_wifi_scan_start(&scan_config, false);
+    if (err != ESP_OK) {
+        m_scanning = false;
+        ESP_LOGW(TAG, "Roaming scan not started: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Reassociates to a BSSID of the current network.
+ *
+ * Pins the target BSSID and channel in the station configuration and calls esp_wifi_connect()
+ * on the associated station, which moves it without a full disconnect/scan cycle.
+ *
+ * @param target Scan record of the new access point.
+ */
+void RoamingController::roamTo(const wifi_ap_record_t& target) {
+    wifi_config_t config = {};
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK) return;
+    config.sta.bssid_set = true;
+    memcpy(config.sta.bssid, target.bssid, sizeof(config.sta.bssid));
+    config.sta.channel = target.primary;
+    applyTo(config.sta);
+
+    ESP_LOGI(TAG, "Roaming from " MACSTR " to " MACSTR " (channel %d, %d dBm)",
+             MAC2STR(m_bssid), MAC2STR(target.bssid), target.primary, target.rssi);
+    portENTER_CRITICAL(&m_lock);
+    m_stats.last_rssi_before = m_trigger_rssi;
+    m_stats.last_rssi_after = target.rssi;
+    portEXIT_CRITICAL(&m_lock);
+
+    m_roam_started_us = esp_timer_get_time();
+    if (esp_wifi_set_config(WIFI_IF_STA, &config) != ESP_OK || esp_wifi_connect() != ESP_OK) {
+        finishRoam(false);
+    }
+}
+
+/**
+ * @brief Records the end of a roam attempt.
+ *
+ * @param success True if the station reassociated.
+ */
+void RoamingController::finishRoam(bool success) {
+    int64_t duration_ms = (esp_timer_get_time() - m_roam_started_us) / 1000;
+    m_roam_started_us = 0;
+
+    portENTER_CRITICAL(&m_lock);
+    if (success) {
+        m_stats.roams++;
+        m_stats.last_roam_ms = duration_ms;
+    } else {
+        m_stats.failed_roams++;
+    }
+    portEXIT_CRITICAL(&m_lock);
+
+    if (success) {
+        m_btm_tried = false;
+        m_neighbor_tried = false;
+        ESP_LOGI(TAG, "Roamed to " MACSTR " in %" PRId64 " ms", MAC2STR(m_bssid), duration_ms);
+    } else {
+        ESP_LOGW(TAG, "Roam failed after %" PRId64 " ms", duration_ms);
+    }
+}
+
+/**
+ * @brief Schedules re-arming of the RSSI threshold after @ref Policy::retrigger_ms.
+ */
+void RoamingController::scheduleRearm() {
+    esp_timer_stop(m_timer);
+    esp_timer_start_once(m_timer, (uint64_t) m_policy.retrigger_ms * 1000);
+}
+
+/**
+ * @brief esp_timer callback that re-arms the RSSI threshold.
+ *
+ * The driver reports WIFI_EVENT_STA_BSS_RSSI_LOW only once per arming, so the threshold is
+ * set again after every attempt; if the signal is still weak, the next trigger follows.
+ *
+ * @param arg Pointer to the RoamingController instance.
+ */
+void RoamingController::rearmCallback(void* arg) {
+    RoamingController* self = static_cast<RoamingController*>(arg);
+    if (self->m_enabled && self->m_associated) {
+        esp_wifi_set_rssi_threshold(self->m_policy.rssi_threshold);
+    }
+}
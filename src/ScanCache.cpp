@@ -0,0 +1,122 @@
+/**
+ * @file ScanCache.cpp
+ * @brief Implementation of the ScanCache class holding the most recent scan results.
+ */
+
+#include "ScanCache.h"
+#include <cstring>
+
+/**
+ * @brief Constructs an empty ScanCache object.
+ */
+ScanCache::ScanCache() :
+    m_entries{},
+    m_count(0),
+    m_lock(portMUX_INITIALIZER_UNLOCKED)
+{
+}
+
+/**
+ * @brief Adds or refreshes one access point from a scan result.
+ *
+ * @param record The scan result.
+ * @param now_us esp_timer timestamp of the scan.
+ */
+void ScanCache::add(const wifi_ap_record_t& record, int64_t now_us) {
+    if (record.ssid[0] == '\0') return;
+
+    Entry entry = {};
+    strncpy(entry.ssid, (const char*) record.ssid, sizeof(entry.ssid) - 1);
+    memcpy(entry.bssid, record.bssid, sizeof(entry.bssid));
+    entry.rssi = record.rssi;
+    entry.channel = record.primary;
+    entry.authmode = record.authmode;
+    entry.last_seen_us = now_us;
+
+    portENTER_CRITICAL(&m_lock);
+    size_t slot = m_count;
+    size_t weakest = 0;
+    for (size_t i = 0; i < m_count; i++) {
+        if (memcmp(m_entries[i].bssid, entry.bssid, sizeof(entry.bssid)) == 0) {
+            slot = i;
+            break;
+        }
+        if (m_entries[i].rssi < m_entries[weakest].rssi) weakest = i;
+    }
+    if (slot == m_count) {
+        if (m_count < CAPACITY) {
+            m_count++;
+        } else if (m_entries[weakest].rssi < entry.rssi) {
+            slot = weakest;
+        } else {
+            slot = CAPACITY;
+        }
+    }
+    if (slot < CAPACITY) m_entries[slot] = entry;
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Adds or refreshes every record of a scan and drops expired entries.
+ *
+ * @param records Scan results.
+ * @param count Number of entries in @p records.
+ */
+void ScanCache::update(const wifi_ap_record_t* records, size_t count) {
+    int64_t now_us = esp_timer_get_time();
+    for (size_t i = 0; i < count; i++) {
+        add(records[i], now_us);
+    }
+    expire(now_us);
+}
+
+/**
+ * @brief Drops entries not seen for SCAN_CACHE_MAX_AGE_MS.
+ *
+ * @param now_us Current esp_timer timestamp.
+ */
+void ScanCache::expire(int64_t now_us) {
+    portENTER_CRITICAL(&m_lock);
+    for (size_t i = m_count; i-- > 0;) {
+        if (now_us - m_entries[i].last_seen_us > (int64_t) SCAN_CACHE_MAX_AGE_MS * 1000) {
+            removeLocked(i);
+        }
+    }
+    portEXIT_CRITICAL(&m_lock);
+}
+
+/**
+ * @brief Copies one entry.
+ *
+ * @param index Entry index, starting at 0.
+ * @param out Output parameter for the entry.
+ * @return true if @p index was valid, false past the last entry.
+ */
+bool ScanCache::get(size_t index, Entry& out) const {
+    portENTER_CRITICAL(&m_lock);
+    bool valid = index < m_count;
+    if (valid) out = m_entries[index];
+    portEXIT_CRITICAL(&m_lock);
+    return valid;
+}
+
+/**
+ * @brief Returns the number of cached access points.
+ *
+ * @return size_t Number of entries.
+ */
+size_t ScanCache::size() const {
+    portENTER_CRITICAL(&m_lock);
+    size_t count = m_count;
+    portEXIT_CRITICAL(&m_lock);
+    return count;
+}
+
+/**
+ * @brief Removes an entry by moving the last entry into its slot. Lock must be held.
+ *
+ * @param index Index of the entry to remove.
+ */
+void ScanCache::removeLocked(size_t index) {
+    m_entries[index] = m_entries[--m_count];
+}
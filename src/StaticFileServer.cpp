@@ -0,0 +1,240 @@
+/**
+ * @file StaticFileServer.cpp
+ * @brief Implementation of the StaticFileServer class serving files from the LittleFS partition.
+ */
+
+#include "StaticFileServer.h"
+#include "AssetCache.h"
+#include <cctype>
+#include <cstring>
+#include <strings.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** @brief Logging tag for the StaticFileServer class. */
+static const char* TAG = "StaticFiles";
+
+/**
+ * @struct MimeType
+ * @brief Maps a file extension to its content type.
+ */
+struct MimeType {
+    /** @brief Extension including the dot, compared case-insensitively. */
+    const char* extension;
+    /** @brief Content type. */
+    const char* type;
+};
+
+/** @brief Content types by extension. */
+static constexpr MimeType MIME_TYPES[] = {
+    {".html", "text/html"},
+    {".htm", "text/html"},
+    {".css", "text/css"},
+    {".js", "application/javascript"},
+    {".mjs", "application/javascript"},
+    {".json", "application/json"},
+    {".txt", "text/plain"},
+    {".svg", "image/svg+xml"},
+    {".png", "image/png"},
+    {".jpg", "image/jpeg"},
+    {".jpeg", "image/jpeg"},
+    {".gif", "image/gif"},
+    {".webp", "image/webp"},
+    {".ico", "image/x-icon"},
+    {".woff", "font/woff"},
+    {".woff2", "font/woff2"},
+    {".wasm", "application/wasm"},
+};
+
+/**
+ * @brief Constructs a StaticFileServer object.
+ *
+ * @param fs Filesystem to serve from; mounted on first use.
+ * @param streamer Sends the file bodies.
+ */
+StaticFileServer::StaticFileServer(LazyFileSystem& fs, FileStreamer& streamer) :
+    m_fs(fs),
+    m_streamer(streamer)
+{
+}
+
+/**
+ * @brief Sends a file as the complete response.
+ *
+ * @param req HTTP request handle.
+ * @param path Path relative to STATIC_FILES_DIR, starting with '/'; a query string is ignored.
+ * @return esp_err_t ESP_OK if a response was sent, ESP_ERR_NOT_FOUND if the path is invalid
+ *         or the file does not exist, error code otherwise.
+ */
+esp_err_t StaticFileServer::serve(httpd_req_t* req, const char* path) {
+    char filepath[STATIC_MAX_PATH_LEN + 4];  // room for the ".gz" suffix
+    if (!resolve(path, filepath, sizeof(filepath) - 3)) return ESP_ERR_NOT_FOUND;
+    esp_err_t ret = m_fs.ensureMounted();
+    if (ret != ESP_OK) return ret;
+
+    const char* type = mimeType(filepath);
+    size_t length = strlen(filepath);
+    struct stat st;
+    bool gzip = false;
+    if (AssetCache::acceptsGzip(req)) {
+        memcpy(filepath + length, ".gz", 4);
+        gzip = stat(filepath, &st) == 0 && S_ISREG(st.st_mode);
+        if (!gzip) filepath[length] = '\0';
+    }
+    if (!gzip && (stat(filepath, &st) != 0 || !S_ISREG(st.st_mode))) return ESP_ERR_NOT_FOUND;
+
+    int fd = open(filepath, O_RDONLY, 0);
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        ESP_LOGE(TAG, "Failed to open %s", filepath);
+        if (fd != -1) close(fd);
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    // Size and mtime change whenever the file is rewritten; the suffix keeps the gzip
+    // representation apart from the plain one. Header values are referenced, not copied.
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%lx-%llx%s\"", (unsigned long) st.st_size, (unsigned long long) st.st_mtime,
+             gzip ? "-gz" : "");
+    if (AssetCache::matchesIfNoneMatch(req, etag)) {
+        close(fd);
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_set_hdr(req, "Cache-Control", ASSET_CACHE_CONTROL);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    size_t size = (size_t) st.st_size;
+    size_t start = 0;
+    size_t end = size ? size - 1 : 0;
+    int range = 0;
+    char value[48];
+    if (httpd_req_get_hdr_value_str(req, "Range", value, sizeof(value)) == ESP_OK) {
+        range = parseRange(value, size, &start, &end);
+        // If-Range needs a strong match; a date or a stale ETag means the client's partial copy
+        // is of another version, so the whole file is sent instead.
+        if (httpd_req_get_hdr_value_str(req, "If-Range", value, sizeof(value)) == ESP_OK && strcmp(value, etag) != 0) {
+            range = 0;
+            start = 0;
+            end = size ? size - 1 : 0;
+        }
+    }
+
+    char content_range[48];
+    if (range < 0) {
+        close(fd);
+        // Header values are referenced, not copied, until the response is sent.
+        snprintf(content_range, sizeof(content_range), "bytes */%u", (unsigned) size);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // FileStreamer writes the header block itself: headers go in the Response, since values
+    // set with httpd_resp_set_hdr() would be dropped.
+    FileStreamer::Response response;
+    response.type = type;
+    response.encoding = gzip ? "gzip" : nullptr;
+    response.accept_ranges = true;
+    response.etag = etag;
+    response.cache_control = ASSET_CACHE_CONTROL;
+    if (range > 0) {
+        snprintf(content_range, sizeof(content_range), "bytes %u-%u/%u", (unsigned) start, (unsigned) end, (unsigned) size);
+        response.status = "206 Partial Content";
+        response.content_range = content_range;
+    }
+    ret = m_streamer.stream(req, fd, start, size ? end - start + 1 : 0, response);
+    close(fd);
+    if (ret == ESP_ERR_NO_MEM) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Served %s bytes %u-%u/%u", filepath, (unsigned) start, (unsigned) end, (unsigned) size);
+    return ret == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Returns the content type for a file name.
+ *
+ * @param path File name or path.
+ * @return const char* Content type; "application/octet-stream" for unknown extensions.
+ */
+const char* StaticFileServer::mimeType(const char* path) {
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr(slash ? slash : path, '.');
+    if (dot) {
+        for (const MimeType& mime : MIME_TYPES) {
+            if (strcasecmp(dot, mime.extension) == 0) return mime.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+/**
+ * @brief Checks a request path and builds the file path on the partition.
+ *
+ * Accepts letters, digits, '/', '.', '-' and '_' only (so no percent-encoding), rejects empty
+ * segments and segments starting with a dot, and stops at a query string.
+ *
+ * @param path Request path relative to STATIC_FILES_DIR.
+ * @param out Output buffer for the file path.
+ * @param size Capacity of @p out.
+ * @return true if the path is safe and fits.
+ */
+bool StaticFileServer::resolve(const char* path, char* out, size_t size) {
+    size_t length = strcspn(path, "?#");
+    if (length == 0 || path[0] != '/' || path[length - 1] == '/') return false;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = path[i];
+        if (!isalnum((unsigned char) c) && c != '/' && c != '.' && c != '-' && c != '_') return false;
+        if (c == '/' && (path[i + 1] == '/' || path[i + 1] == '.')) return false;
+    }
+
+    int written = snprintf(out, size, LFS_BASE_PATH STATIC_FILES_DIR "%.*s", (int) length, path);
+    return written > 0 && (size_t) written < size;
+}
+
+/**
+ * @brief Parses a single-range "bytes=" Range header against a file size.
+ *
+ * Supports "bytes=first-", "bytes=first-last" and "bytes=-suffix". Malformed headers and
+ * multiple ranges are ignored, as HTTP allows.
+ *
+ * @param value Header value.
+ * @param size File size in bytes.
+ * @param start Output first byte offset.
+ * @param end Output last byte offset (inclusive).
+ * @return int 1 if the range is satisfiable, 0 if the header should be ignored, -1 if it is unsatisfiable.
+ */
+int StaticFileServer::parseRange(const char* value, size_t size, size_t* start, size_t* end) {
+    if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ',')) return 0;
+    const char* spec = value + 6;
+    char* rest = nullptr;
+
+    if (*spec == '-') {
+        unsigned long suffix = strtoul(spec + 1, &rest, 10);
+        if (rest == spec + 1 || *rest != '\0') return 0;
+        if (suffix == 0 || size == 0) return -1;
+        *start = suffix >= size ? 0 : size - suffix;
+        *end = size - 1;
+        return 1;
+    }
+
+    unsigned long first = strtoul(spec, &rest, 10);
+    if (rest == spec || *rest != '-') return 0;
+    unsigned long last = size ? size - 1 : 0;
+    const char* last_spec = rest + 1;
+    if (*last_spec != '\0') {
+        last = strtoul(last_spec, &rest, 10);
+        if (rest == last_spec || *rest != '\0' || last < first) return 0;
+    }
+    if (first >= size) return -1;
+    *start = first;
+    *end = last >= size ? size - 1 : last;
+    return 1;
+}
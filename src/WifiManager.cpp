@@ -6,49 +6,155 @@
 #include "WifiManager.h"
 #include "config.h"
 #include <cstring>
+#include <ctime>
 #include <sys/stat.h> 
 #include <fcntl.h>    
 #include <unistd.h>   
+#include "mbedtls/pkcs5.h"
+#include "lwip/sockets.h"
+#include "lwip/etharp.h"
+#include "lwip/dhcp.h"
+#include "esp_netif_net_stack.h"
 
 /** @brief Logging tag for the WifiManager class. */
 static const char* TAG = "WifiManager";
 
 /** @brief Event bit for signaling successful Wi-Fi connection. */
-#define WIFI_CONNECTED_BIT BIT0
-/** @brief Event bit for signaling failed Wi-Fi connection. */
-#define WIFI_FAIL_BIT      BIT1
+#define WIFI_CONNECTED_BIT    BIT0
+/** @brief Event bit for signaling that provisioning mode was entered. */
+#define WIFI_PROVISIONING_BIT BIT1
+
+/** @brief Web assets kept in RAM by the asset cache; the gzip variant produced by scripts/build_assets.py is preferred. */
+static const AssetCache::Asset CACHED_ASSETS[] = {
+    {"/index.html", "/index.html.gz", "text/html", "gzip"},
+    {"/index.html", "/index.html", "text/html", nullptr},
+};
 
 /**
  * @brief Constructs a new WifiManager object.
  *
- * Initializes the event group and sets default values for member variables.
+ * Initializes the event group and event queue and sets default values for member variables.
+ *
+ * @param fs Filesystem holding the provisioning page.
  */
-WifiManager::WifiManager() : 
+WifiManager::WifiManager(LazyFileSystem& fs) :
+    m_task(nullptr),
+    m_candidates{},
+    m_candidate_count(0),
+    m_next_candidate(0),
     m_server(nullptr),
-    m_is_connected(false),
-    m_retry_num(0)
+    m_server_provisioning(false),
+    m_server_mutex(xSemaphoreCreateMutex()),
+    m_control_server_enabled(STA_CONTROL_SERVER_ENABLED),
+    m_fs(fs),
+    m_assets(fs, CACHED_ASSETS, sizeof(CACHED_ASSETS) / sizeof(CACHED_ASSETS[0])),
+    m_static(fs, m_streamer),
+    m_littlefs_bytes_sent(0),
+    m_littlefs_serve_us(0),
+    m_portal_url{},
+    m_active_network(-1),
+    m_background_scan(false),
+    m_sta_netif(nullptr),
+    m_ap_netif(nullptr),
+    m_wifi_started(false),
+    m_network_ready(false),
+    m_driver_ready(false),
+    m_local_disconnect(false),
+    m_reconnect({RECONNECT_BASE_DELAY_MS, RECONNECT_MAX_DELAY_MS, RECONNECT_BACKOFF_MULTIPLIER, RECONNECT_JITTER_PERCENT}),
+    m_roaming({ROAM_RSSI_THRESHOLD, ROAM_MIN_RSSI_GAIN, ROAM_RETRIGGER_MS}),
+    m_fast_connect_active(false),
+    m_sta_associated(false),
+    m_validating(false),
+    m_pending_network{},
+    m_validation_result(ValidationResult::Pending),
+    m_connect_start_us(0),
+    m_time_to_ip_us(0),
+    m_ip_mode(IpMode::Dhcp),
+    m_static_ip{},
+    m_lease{},
+    m_lease_valid(false),
+    m_lease_granted(0),
+    m_lease_seconds(0),
+    m_lease_applied(false),
+    m_lease_verifying(false),
+    m_lease_probes(0),
+    m_lease_verify_timer(nullptr),
+    m_lease_expiry_timer(nullptr),
+    m_idle_session_timer(nullptr),
+    m_handoff_timer(nullptr),
+    m_handoff_pending(false)
 {
     m_wifi_event_group = xEventGroupCreate();
+    m_event_queue = xQueueCreate(WIFI_EVENT_QUEUE_LENGTH, sizeof(ConnectionEvent));
 }
 
 /**
  * @brief Destroys the WifiManager object.
  *
- * Stops the web server and deletes the event group.
+ * Stops the web server and the DNS responder and deletes the event group.
  */
 WifiManager::~WifiManager() {
     stopWebServer();
+    m_dns.stop();
+    if (m_lease_verify_timer) {
+        esp_timer_stop(m_lease_verify_timer);
+        esp_timer_delete(m_lease_verify_timer);
+    }
+    if (m_lease_expiry_timer) {
+        esp_timer_stop(m_lease_expiry_timer);
+        esp_timer_delete(m_lease_expiry_timer);
+    }
+    if (m_idle_session_timer) esp_timer_delete(m_idle_session_timer);
+    if (m_handoff_timer) {
+        esp_timer_stop(m_handoff_timer);
+        esp_timer_delete(m_handoff_timer);
+    }
+    if (m_task) vTaskDelete(m_task);
+    vQueueDelete(m_event_queue);
     vEventGroupDelete(m_wifi_event_group);
+    if (m_server_mutex) vSemaphoreDelete(m_server_mutex);
 }
 
 /**
- * @brief Initializes the TCP/IP stack and default event loop.
+ * @brief Logs free heap, largest free block and the resulting fragmentation.
  *
- * Registers event handlers for Wi-Fi and IP events.
+ * @param stage Label printed with the figures.
  */
-void WifiManager::initialize() {
+static void logHeapFragmentation(const char* stage) {
+    size_t free_bytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    unsigned fragmentation = free_bytes ? (unsigned) (100 - (largest * 100) / free_bytes) : 0;
+    ESP_LOGI(TAG, "Heap %s: free %u, largest block %u, fragmentation %u%%",
+             stage, (unsigned) free_bytes, (unsigned) largest, fragmentation);
+}
+
+/**
+ * @brief Initializes the TCP/IP stack, the default event loop and both default netifs.
+ *
+ * Both default netifs are created exactly once; later mode switches only change the mode
+ * and configuration (see switchMode()).
+ */
+void WifiManager::initNetwork() {
+    if (m_network_ready) return;
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    m_sta_netif = esp_netif_create_default_wifi_sta();
+    m_ap_netif = esp_netif_create_default_wifi_ap();
+    m_network_ready = true;
+}
+
+/**
+ * @brief Initializes the Wi-Fi driver and registers the event handlers.
+ *
+ * The driver is initialized exactly once. Registers event handlers for Wi-Fi and IP events
+ * and creates the timers used by the connection logic.
+ */
+void WifiManager::initDriver() {
+    if (m_driver_ready) return;
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
     
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
                                                         ESP_EVENT_ANY_ID,
@@ -60,174 +166,1349 @@ void WifiManager::initialize() {
                                                         &eventHandler,
                                                         this,
                                                         nullptr));
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &onLeaseCheckDue;
+    timer_args.arg = this;
+    timer_args.name = "lease_verify";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &m_lease_verify_timer));
+    timer_args.callback = &onLeaseExpiryDue;
+    timer_args.name = "lease_expiry";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &m_lease_expiry_timer));
+    timer_args.callback = &idleSessionCheck;
+    timer_args.name = "idle_sessions";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &m_idle_session_timer));
+    timer_args.callback = &onHandoffDue;
+    timer_args.name = "prov_handoff";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &m_handoff_timer));
+    ESP_ERROR_CHECK(m_reconnect.init(&onRetryDue, this));
+    ESP_ERROR_CHECK(m_roaming.init());
+    m_driver_ready = true;
+}
+
+/**
+ * @brief Checks if the device is connected to Wi-Fi in Station mode.
+ *
+ * @return true if connected, false otherwise.
+ */
+bool WifiManager::isConnected() const {
+    return m_link.read().connected;
+}
+
+/**
+ * @brief Retrieves the current IP address in Station mode.
+ *
+ * @return esp_ip4_addr_t The address, 0 if not connected.
+ */
+esp_ip4_addr_t WifiManager::getIpAddress() const {
+    return m_link.read().ip;
+}
+
+/**
+ * @brief Retrieves the reconnection counters.
+ *
+ * @return ReconnectScheduler::Stats Copy of the current counters.
+ */
+ReconnectScheduler::Stats WifiManager::getReconnectStats() const {
+    return m_reconnect.getStats();
+}
+
+/**
+ * @brief Enables roaming between access points of the connected network. Must be called before start().
+ *
+ * @param enabled True to enable roaming.
+ */
+void WifiManager::setRoamingEnabled(bool enabled) {
+    m_roaming.setEnabled(enabled);
+}
+
+/**
+ * @brief Drops the in-memory copy of the web assets; they are reloaded on the next request.
+ */
+void WifiManager::invalidateAssetCache() {
+    m_assets.invalidate();
+}
+
+/**
+ * @brief Enables or disables the station-mode control server.
+ *
+ * @param enabled True to serve the control endpoints while connected.
+ */
+void WifiManager::setControlServerEnabled(bool enabled) {
+    m_control_server_enabled = enabled;
+    if (!enabled) {
+        stopWebServer(true);
+    } else if (getState() == ConnectionState::GotIP) {
+        startWebServer(false);
+    }
+}
+
+/**
+ * @brief Retrieves the roaming counters.
+ *
+ * @return RoamingController::Stats Copy of the current counters.
+ */
+RoamingController::Stats WifiManager::getRoamingStats() const {
+    return m_roaming.getStats();
+}
+
+/**
+ * @brief Copies the phase timings of the last connection attempts, newest first.
+ *
+ * @param out Output array.
+ * @param max Capacity of @p out.
+ * @return size_t Number of records written.
+ */
+size_t WifiManager::getConnectionTimings(ConnectionTimingLog::Record* out, size_t max) const {
+    return m_timings.snapshot(out, max);
+}
+
+/**
+ * @brief Subscribes a queue to connectivity changes (up, down, IP changed, roamed).
+ *
+ * @param queue Queue created with an item size of sizeof(LinkEventPublisher::LinkEvent).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if LINK_EVENT_MAX_SUBSCRIBERS are subscribed.
+ */
+esp_err_t WifiManager::subscribe(QueueHandle_t queue) {
+    return m_link_events.subscribe(queue);
+}
+
+/**
+ * @brief Removes a queue added with subscribe().
+ *
+ * @param queue The queue.
+ */
+void WifiManager::unsubscribe(QueueHandle_t queue) {
+    m_link_events.unsubscribe(queue);
+}
+
+/**
+ * @brief Starts the Wi-Fi management process.
+ *
+ * Completes any initialization step not run yet and spawns the connection task, then
+ * returns immediately.
+ */
+void WifiManager::start() {
+    if (m_task) return;
+    initNetwork();
+    initDriver();
+
+    if (xTaskCreate(&connectionTask, "wifi_conn", WIFI_TASK_STACK_SIZE, this, WIFI_TASK_PRIORITY, &m_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create connection task");
+        m_task = nullptr;
+    }
+}
+
+/**
+ * @brief Registers a callback for state transitions. Must be called before start().
+ *
+ * @param callback Callback invoked from the connection task with the new state.
+ */
+void WifiManager::setStateCallback(StateCallback callback) {
+    m_state_callback = std::move(callback);
+}
+
+/**
+ * @brief Returns the current state of the connection lifecycle.
+ *
+ * @return ConnectionState The current state.
+ */
+WifiManager::ConnectionState WifiManager::getState() const {
+    return m_link.read().state;
+}
+
+/**
+ * @brief Returns a consistent snapshot of state, IP, RSSI and BSSID.
+ *
+ * @return LinkStatus The snapshot.
+ */
+WifiManager::LinkStatus WifiManager::getLinkStatus() const {
+    uint32_t generation = 0;
+    LinkStatus status = m_link.read(&generation);
+    status.generation = generation;
+    return status;
+}
+
+/**
+ * @brief Blocks until the device is connected or has entered provisioning mode.
+ *
+ * @param timeout Maximum time to wait, in ticks.
+ * @return ConnectionState The state at the time the wait ended.
+ */
+WifiManager::ConnectionState WifiManager::waitForConnection(TickType_t timeout) {
+    xEventGroupWaitBits(m_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_PROVISIONING_BIT, pdFALSE, pdFALSE, timeout);
+    return getState();
+}
+
+/**
+ * @brief Entry point of the connection task.
+ *
+ * @param arg Pointer to the WifiManager instance.
+ */
+void WifiManager::connectionTask(void* arg) {
+    static_cast<WifiManager*>(arg)->runConnectionLoop();
+}
+
+/**
+ * @brief Processes connection events for the lifetime of the manager.
+ *
+ * The first event is derived from the stored credentials. While an attempt is in the
+ * Connecting state, the queue wait is bounded by WIFI_CONNECT_TIMEOUT_MS (or
+ * PROV_VALIDATION_TIMEOUT_MS when validating); on timeout the attempt is aborted and
+ * handled like a disconnect. The task keeps running in provisioning mode to validate
+ * submitted credentials and to refresh the scan cache every SCAN_CACHE_REFRESH_MS.
+ * AddressAssigned, LeaseCheckDue, LeaseExpired and HandoffDue bypass the state machine; they
+ * carry the lease work (NVS writes, ARP probes, DHCP at expiry) and the AP shutdown off the
+ * event loop and the timer task.
+ */
+void WifiManager::runConnectionLoop() {
+    FastConnectRecord record;
+    if (m_credentials.load() != ESP_OK || m_credentials.size() == 0) {
+        handleEvent(ConnectionEvent::NoCredentials);
+    } else if (loadFastConnectRecord(record) == ESP_OK && m_credentials.indexOf(record.ssid) >= 0) {
+        handleEvent(ConnectionEvent::FastConnect);
+    } else {
+        handleEvent(ConnectionEvent::Start);
+    }
+
+    while (true) {
+        TickType_t wait = portMAX_DELAY;
+        ConnectionState state = m_state_machine.state();
+        if (state == ConnectionState::Connecting) {
+            wait = pdMS_TO_TICKS(m_validating ? PROV_VALIDATION_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS);
+        } else if (state == ConnectionState::Provisioning) {
+            wait = pdMS_TO_TICKS(SCAN_CACHE_REFRESH_MS);
+        }
+        ConnectionEvent event;
+        if (xQueueReceive(m_event_queue, &event, wait) != pdTRUE) {
+            if (state == ConnectionState::Provisioning) {
+                startBackgroundScan();
+                continue;
+            }
+            ESP_LOGW(TAG, "Connection attempt timed out");
+            m_timings.onFailed(WIFI_REASON_CONNECTION_FAIL);
+            m_local_disconnect = true;
+            esp_wifi_disconnect();
+            if (m_validating) {
+                m_fast_connect_active.store(false);
+                m_validation_result = m_sta_associated ? ValidationResult::DhcpTimeout : ValidationResult::Failed;
+                event = ConnectionEvent::AttemptFailed;
+            } else {
+                event = m_reconnect.schedule(WIFI_REASON_CONNECTION_FAIL) ? ConnectionEvent::Disconnected
+                                                                          : ConnectionEvent::AttemptFailed;
+            }
+        }
+        if (event == ConnectionEvent::AddressAssigned) {
+            onAddressAssigned();
+        } else if (event == ConnectionEvent::LeaseCheckDue) {
+            verifyLease();
+        } else if (event == ConnectionEvent::LeaseExpired) {
+            expireLease();
+        } else if (event == ConnectionEvent::HandoffDue) {
+            leaveProvisioning();
+        } else {
+            handleEvent(event);
+        }
+    }
+}
+
+/**
+ * @brief Applies an event to the state machine and runs the entry action of the new state.
+ *
+ * Entry actions may produce a follow-up event (e.g. the scan result), which is applied
+ * immediately in the same call.
+ *
+ * @param event The event to apply.
+ */
+void WifiManager::handleEvent(ConnectionEvent event) {
+    if (event == ConnectionEvent::AttemptFailed && m_state_machine.state() == ConnectionState::Connecting) {
+        event = resolveFailedAttempt();
+    }
+
+    while (true) {
+        ConnectionState from = m_state_machine.state();
+        if (!m_state_machine.dispatch(event)) {
+            ESP_LOGD(TAG, "Event %d ignored in state %s", (int) event, ConnectionStateMachine::toString(from));
+            return;
+        }
+        ConnectionState to = m_state_machine.state();
+        m_link.modify([to](LinkStatus& link) { link.state = to; });
+        ESP_LOGI(TAG, "State %s -> %s", ConnectionStateMachine::toString(from), ConnectionStateMachine::toString(to));
+
+        ConnectionEvent follow_up;
+        bool has_follow_up = enterState(to, event, follow_up);
+        if (m_state_callback) m_state_callback(to);
+        if (!has_follow_up) return;
+        event = follow_up;
+    }
+}
+
+/**
+ * @brief Runs the entry action of a state.
+ *
+ * @param state The state just entered.
+ * @param cause The event that caused the transition.
+ * @param follow_up Output parameter for an event produced by the entry action.
+ * @return true if @p follow_up was set, false otherwise.
+ */
+bool WifiManager::enterState(ConnectionState state, ConnectionEvent cause, ConnectionEvent& follow_up) {
+    switch (state) {
+        case ConnectionState::Scanning:
+            m_candidate_count = scanForKnownNetworks(m_candidates, CredentialStore::CAPACITY);
+            m_next_candidate = 0;
+            if (m_candidate_count == 0) ESP_LOGW(TAG, "No stored network in range");
+            follow_up = m_candidate_count > 0 ? ConnectionEvent::ScanDone : ConnectionEvent::NoCandidates;
+            return true;
+
+        case ConnectionState::Connecting:
+            if (cause == ConnectionEvent::RetryDue) {
+                m_timings.beginAttempt(ConnectionTimingLog::Kind::Retry);
+                unpinStation();
+                esp_wifi_connect();
+            } else if (cause == ConnectionEvent::FastConnect) {
+                FastConnectRecord record;
+                loadFastConnectRecord(record);
+                int index = m_credentials.indexOf(record.ssid);
+                CredentialStore::Network network = m_credentials.at(index);
+                ESP_LOGI(TAG, "Fast-connecting to '%s' (" MACSTR ", channel %d)",
+                         network.ssid, MAC2STR(record.bssid), record.channel);
+                selectNetwork(index);
+                connectToWifi(network.ssid, network.password, &record, true);
+            } else if (cause == ConnectionEvent::CredentialsReceived) {
+                startValidation();
+            } else {
+                connectToNextCandidate();
+            }
+            return false;
+
+        case ConnectionState::GotIP: {
+            xEventGroupSetBits(m_wifi_event_group, WIFI_CONNECTED_BIT);
+            bool validated = m_validating;
+            if (validated) {
+                // Armed before the result is published, so the first poll that sees it can
+                // shorten the hand-off.
+                m_handoff_pending = true;
+                acceptValidatedNetwork();
+            }
+
+            int64_t time_to_ip_us = m_time_to_ip_us.exchange(0);
+            if (time_to_ip_us != 0 && m_active_network >= 0) {
+                bool cache_hit = !validated && m_next_candidate == 0;
+                ESP_LOGI(TAG, "Time to IP: %" PRId64 " ms (fast-connect cache %s)", time_to_ip_us / 1000,
+                         cache_hit ? "hit" : "miss");
+                m_credentials.markSuccess(m_active_network);
+                if (!cache_hit) {
+                    CredentialStore::Network network = m_credentials.at(m_active_network);
+                    saveFastConnectRecord(network.ssid, network.password);
+                }
+            }
+            if (validated) {
+                // The AP stays up until the provisioning page has fetched the result; the
+                // status handler shortens this fallback once it has (then this start fails).
+                esp_timer_start_once(m_handoff_timer, (uint64_t) PROV_HANDOFF_TIMEOUT_MS * 1000);
+            } else if (m_control_server_enabled) {
+                startWebServer(false);
+            }
+            return false;
+        }
+
+        case ConnectionState::Backoff:
+            xEventGroupClearBits(m_wifi_event_group, WIFI_CONNECTED_BIT);
+            return false;
+
+        case ConnectionState::Provisioning:
+            if (m_validating) {
+                completeValidation();
+                return false;
+            }
+            ESP_LOGW(TAG, "Failed to connect with stored credentials");
+            startProvisioning();
+            xEventGroupSetBits(m_wifi_event_group, WIFI_PROVISIONING_BIT);
+            return false;
+
+        case ConnectionState::Idle:
+            return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Picks the event describing a failed attempt: next candidate, rescan or give up.
+ *
+ * A failed fast connect invalidates the cached record and falls back to a scan.
+ *
+ * @return ConnectionEvent The resolved event.
+ */
+WifiManager::ConnectionEvent WifiManager::resolveFailedAttempt() {
+    if (m_validating) return ConnectionEvent::CandidatesExhausted;
+    if (m_candidate_count == 0 && m_next_candidate == 0) {
+        ESP_LOGW(TAG, "Fast connect failed, invalidating cache and scanning");
+        clearFastConnectRecord();
+        return ConnectionEvent::Rescan;
+    }
+    if (m_active_network >= 0) {
+        ESP_LOGW(TAG, "Failed to connect to '%s'", m_credentials.at(m_active_network).ssid);
+    }
+    return (m_next_candidate < m_candidate_count) ? ConnectionEvent::AttemptFailed : ConnectionEvent::CandidatesExhausted;
+}
+
+/**
+ * @brief Starts a directed connect to the next scanned candidate.
+ */
+void WifiManager::connectToNextCandidate() {
+    const CredentialStore::Candidate& candidate = m_candidates[m_next_candidate++];
+    CredentialStore::Network network = m_credentials.at(candidate.index);
+    ESP_LOGI(TAG, "Connecting to '%s' (" MACSTR ", channel %d, RSSI %d, score %d)",
+             network.ssid, MAC2STR(candidate.bssid), candidate.channel, candidate.rssi, candidate.score);
+
+    FastConnectRecord target = {};
+    memcpy(target.bssid, candidate.bssid, sizeof(target.bssid));
+    target.channel = candidate.channel;
+
+    selectNetwork(candidate.index);
+    connectToWifi(network.ssid, network.password, &target);
+}
+
+/**
+ * @brief Returns the token reported to the browser for a validation outcome.
+ *
+ * @param result The outcome.
+ * @return const char* Static string.
+ */
+static const char* validationResultToString(WifiManager::ValidationResult result) {
+    switch (result) {
+        case WifiManager::ValidationResult::Pending:       return "pending";
+        case WifiManager::ValidationResult::Success:       return "success";
+        case WifiManager::ValidationResult::WrongPassword: return "wrong_password";
+        case WifiManager::ValidationResult::SsidNotFound:  return "ssid_not_found";
+        case WifiManager::ValidationResult::DhcpTimeout:   return "dhcp_timeout";
+        case WifiManager::ValidationResult::Failed:        return "failed";
+    }
+    return "failed";
+}
+
+/**
+ * @brief Hands credentials from the provisioning page to the connection task for validation.
+ *
+ * Called from the HTTP server task. The network is not stored until it obtains an IP.
+ *
+ * @param network The submitted network.
+ * @return true if the attempt was queued, false if another validation is in progress.
+ */
+bool WifiManager::requestValidation(const CredentialStore::Network& network) {
+    if (getState() != ConnectionState::Provisioning) return false;
+    bool idle = false;
+    if (!m_validating.compare_exchange_strong(idle, true)) return false;
+
+    // The connection task reads the network only after receiving the event.
+    m_pending_network = network;
+    m_validation_result = ValidationResult::Pending;
+    postEvent(ConnectionEvent::CredentialsReceived);
+    return true;
+}
+
+/**
+ * @brief Starts a fail-fast connect with the credentials under validation, keeping the AP up.
+ *
+ * The station joins in APSTA mode, so the SoftAP moves to the target AP's channel; clients
+ * of the provisioning AP may briefly lose their link while it does.
+ */
+void WifiManager::startValidation() {
+    ESP_LOGI(TAG, "Validating credentials for '%s'", m_pending_network.ssid);
+    if (m_background_scan) esp_wifi_scan_stop();
+    m_active_network = -1;
+    m_ip_mode = m_pending_network.ip_mode;
+    m_static_ip = m_pending_network.static_ip;
+    m_lease_valid = false;
+    m_validation_result = ValidationResult::Failed;
+    if (connectToWifi(m_pending_network.ssid, m_pending_network.password, nullptr, true) != ESP_OK) {
+        postEvent(ConnectionEvent::AttemptFailed);
+    }
+}
+
+/**
+ * @brief Stores the validated network and makes it the active one.
+ *
+ * The DHCP lease obtained during validation is saved as well, since IP_EVENT_STA_GOT_IP
+ * fired before the network had a slot in the credential store.
+ */
+void WifiManager::acceptValidatedNetwork() {
+    m_validation_result = ValidationResult::Success;
+    if (m_credentials.upsert(m_pending_network) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store credentials for '%s'", m_pending_network.ssid);
+    }
+    clearFastConnectRecord();
+
+    int index = m_credentials.indexOf(m_pending_network.ssid);
+    if (index >= 0) {
+        selectNetwork(index);
+        esp_netif_ip_info_t ip_info;
+        if (m_ip_mode != IpMode::Static && esp_netif_get_ip_info(m_sta_netif, &ip_info) == ESP_OK) {
+            saveLease(m_sta_netif, ip_info);
+        }
+    }
+    completeValidation();
+}
+
+/**
+ * @brief Publishes @ref m_validation_result to the status endpoint polled by the provisioning page.
+ */
+void WifiManager::completeValidation() {
+    ESP_LOGI(TAG, "Validation of '%s' finished: %s", m_pending_network.ssid,
+             validationResultToString(m_validation_result));
+    m_validating = false;
+}
+
+/**
+ * @brief Shuts down the provisioning AP and web server, keeping the station link.
+ *
+ * Runs PROV_HANDOFF_DELAY_MS after GET /connect delivered the successful result, or
+ * PROV_HANDOFF_TIMEOUT_MS after the validation if no page asked for it. The station control
+ * server takes over if it is enabled and the link is still up; otherwise GotIP starts it on
+ * the next connect.
+ */
+void WifiManager::leaveProvisioning() {
+    m_handoff_pending = false;
+    if (!(xEventGroupGetBits(m_wifi_event_group) & WIFI_PROVISIONING_BIT)) return;  // already handed off
+    if (getState() == ConnectionState::Provisioning) return;
+    stopWebServer();
+    m_dns.stop();
+    switchMode(WIFI_MODE_STA, true);
+    xEventGroupClearBits(m_wifi_event_group, WIFI_PROVISIONING_BIT);
+    ESP_LOGI(TAG, "Provisioning finished, AP stopped");
+    if (m_control_server_enabled && getState() == ConnectionState::GotIP) startWebServer(false);
+}
+
+/**
+ * @brief esp_timer callback; queues ConnectionEvent::HandoffDue.
+ *
+ * @param arg Pointer to the WifiManager instance.
+ */
+void WifiManager::onHandoffDue(void* arg) {
+    static_cast<WifiManager*>(arg)->postEvent(ConnectionEvent::HandoffDue);
+}
+
+/**
+ * @brief Maps the disconnect reason of a rejected validation attempt to its outcome.
+ *
+ * @param reason Reason code from wifi_event_sta_disconnected_t.
+ * @return WifiManager::ValidationResult The outcome reported to the browser.
+ */
+static WifiManager::ValidationResult classifyValidationFailure(uint8_t reason) {
+    switch (ReconnectScheduler::classify(reason)) {
+        case ReconnectScheduler::Category::AuthFailure: return WifiManager::ValidationResult::WrongPassword;
+        case ReconnectScheduler::Category::NoApFound:   return WifiManager::ValidationResult::SsidNotFound;
+        default:                                        return WifiManager::ValidationResult::Failed;
+    }
+}
+
+/**
+ * @brief Queues an event for the connection task.
+ *
+ * @param event The event to queue.
+ */
+void WifiManager::postEvent(ConnectionEvent event) {
+    if (xQueueSend(m_event_queue, &event, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Connection event queue full, dropping event %d", (int) event);
+    }
+}
+
+/**
+ * @brief Publishes a connectivity change built from the current link snapshot.
+ *
+ * @param type Kind of change.
+ * @param reason Disconnect reason for LinkEventPublisher::Type::Down, 0 otherwise.
+ */
+void WifiManager::publishLinkEvent(LinkEventPublisher::Type type, uint8_t reason) {
+    LinkStatus link = m_link.read();
+    LinkEventPublisher::LinkEvent event = {};
+    event.type = type;
+    event.reason = reason;
+    event.rssi = link.rssi;
+    event.channel = link.channel;
+    memcpy(event.bssid, link.bssid, sizeof(event.bssid));
+    event.ip = link.ip;
+    m_link_events.publish(event);
+}
+
+/**
+ * @brief ReconnectScheduler callback; queues ConnectionEvent::RetryDue.
+ *
+ * @param arg Pointer to the WifiManager instance.
+ */
+void WifiManager::onRetryDue(void* arg) {
+    static_cast<WifiManager*>(arg)->postEvent(ConnectionEvent::RetryDue);
+}
+
+/**
+ * @brief Runs one scan and ranks the stored networks found in it.
+ *
+ * Switches to station mode without connecting, performs a blocking all-channel scan
+ * and hands the results to CredentialStore::rank().
+ *
+ * @param candidates Output array, sorted by descending score.
+ * @param max Capacity of @p candidates.
+ * @return size_t Number of candidates written.
+ */
+size_t WifiManager::scanForKnownNetworks(CredentialStore::Candidate* candidates, size_t max) {
+    switchMode(WIFI_MODE_STA);
+
+    int64_t start_us = esp_timer_get_time();
+    if (esp_wifi_scan_start(nullptr, true) != ESP_OK) {
+        ESP_LOGE(TAG, "Scan failed");
+        return 0;
+    }
+
+    uint16_t record_count = SCAN_MAX_RECORDS;
+    std::vector<wifi_ap_record_t> records(record_count);
+    esp_wifi_scan_get_ap_records(&record_count, records.data());
+    m_scan_cache.update(records.data(), record_count);
+    int64_t duration_ms = (esp_timer_get_time() - start_us) / 1000;
+    m_timings.recordScan((uint32_t) duration_ms);
+    ESP_LOGI(TAG, "Scan found %d AP(s) in %" PRId64 " ms", record_count, duration_ms);
+
+    return m_credentials.rank(records.data(), record_count, candidates, max);
+}
+
+/**
+ * @brief Starts a non-blocking scan that refreshes @ref m_scan_cache.
+ *
+ * Requires the station interface, i.e. STA or APSTA mode. Between channels the radio
+ * returns to the home channel for SCAN_HOME_CHANNEL_DWELL_MS, so clients of the
+ * provisioning AP keep being served while the scan runs.
+ */
+void WifiManager::startBackgroundScan() {
+    if (m_background_scan) return;
+
+    wifi_scan_config_t scan_config = {};
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.min = SCAN_CHANNEL_DWELL_MS;
+    scan_config.scan_time.active.max = SCAN_CHANNEL_DWELL_MS;
+    scan_config.home_chan_dwell_time = SCAN_HOME_CHANNEL_DWELL_MS;
+
+    m_background_scan = true;
+    esp_err_t err = esp_wifi_scan_start(&scan_config, false);
+    if (err != ESP_OK) {
+        m_background_scan = false;
+        ESP_LOGW(TAG, "Background scan not started: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Moves the results of a finished background scan into @ref m_scan_cache.
+ *
+ * Records are fetched one at a time, so no result array is allocated.
+ */
+void WifiManager::collectBackgroundScan() {
+    m_background_scan = false;
+
+    int64_t now_us = esp_timer_get_time();
+    uint16_t count = 0;
+    esp_wifi_scan_get_ap_num(&count);
+    wifi_ap_record_t record;
+    for (uint16_t i = 0; i < count && esp_wifi_scan_get_ap_record(&record) == ESP_OK; i++) {
+        m_scan_cache.add(record, now_us);
+    }
+    esp_wifi_clear_ap_list();
+    m_scan_cache.expire(now_us);
+    ESP_LOGD(TAG, "Background scan: %d AP(s), %u cached", count, (unsigned) m_scan_cache.size());
+}
+
+/**
+ * @brief Makes a stored network the active one and loads its IP configuration.
+ *
+ * @param index Index of the network in the credential store.
+ */
+void WifiManager::selectNetwork(size_t index) {
+    CredentialStore::Network network = m_credentials.at(index);
+    m_active_network = (int) index;
+    m_ip_mode = network.ip_mode;
+    m_static_ip = network.static_ip;
+    m_lease = network.lease;
+    m_lease_valid = network.lease_valid != 0;
+    m_lease_granted = network.lease_granted;
+    m_lease_seconds = network.lease_seconds;
+}
+
+/**
+ * @brief Connects to a Wi-Fi Access Point with provided credentials.
+ *
+ * When a target is supplied, the BSSID and channel are pinned so the driver skips the
+ * all-channel scan, and the auth mode the AP used last time becomes the minimum. A target
+ * carrying a cached PMK (WPA/WPA2-PSK only) passes it as a 64-digit hex PSK, which also skips
+ * the PBKDF2 passphrase derivation; other targets send the passphrase. The pin only holds for
+ * this attempt: retries call unpinStation() first.
+ *
+ * @param ssid The SSID of the Wi-Fi network.
+ * @param password The password of the Wi-Fi network.
+ * @param target Optional BSSID/channel (and PMK) for a directed connect.
+ * @param fail_fast If true, the first disconnect fails the attempt instead of retrying.
+ * @return esp_err_t ESP_OK if connection attempt starts successfully, ESP_FAIL otherwise.
+ */
+esp_err_t WifiManager::connectToWifi(const std::string& ssid, const std::string& password,
+                                     const FastConnectRecord* target, bool fail_fast) {
+    if (ssid.empty()) {
+        ESP_LOGE(TAG, "SSID cannot be empty");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switchMode(m_validating ? WIFI_MODE_APSTA : WIFI_MODE_STA);
+    applyIpMode(m_sta_netif);
+
+    wifi_config_t wifi_config = {};
+    strncpy((char*)wifi_config.sta.ssid, ssid.c_str(), sizeof(wifi_config.sta.ssid));
+    if (ssid.length() < sizeof(wifi_config.sta.ssid)) {
+        wifi_config.sta.ssid[ssid.length()] = '\0';
+    }
+    if (target && target->pmk_valid) {
+        static const char hex[] = "0123456789abcdef";
+        for (size_t i = 0; i < sizeof(target->pmk); i++) {
+            wifi_config.sta.password[i * 2]     = hex[target->pmk[i] >> 4];
+            wifi_config.sta.password[i * 2 + 1] = hex[target->pmk[i] & 0x0F];
+        }
+    } else {
+        strncpy((char*)wifi_config.sta.password, password.c_str(), sizeof(wifi_config.sta.password));
+        if (password.length() < sizeof(wifi_config.sta.password)) {
+            wifi_config.sta.password[password.length()] = '\0';
+        }
+    }
+    if (target) {
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, target->bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = target->channel;
+        // Rejects a downgraded impostor on the pinned BSSID. An AP that has since moved to SAE
+        // fails this one attempt; the record saved after the rescan then carries its new mode.
+        wifi_config.sta.threshold.authmode = static_cast<wifi_auth_mode_t>(target->authmode);
+    }
+    m_roaming.applyTo(wifi_config.sta);
+
+    m_reconnect.reset();
+    m_fast_connect_active = fail_fast;
+    m_connect_start_us = esp_timer_get_time();
+    m_timings.beginAttempt(m_validating ? ConnectionTimingLog::Kind::Validation
+                           : fail_fast  ? ConnectionTimingLog::Kind::FastConnect
+                                        : ConnectionTimingLog::Kind::Candidate);
+
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    return esp_wifi_connect();
+}
+
+/**
+ * @brief Drops a BSSID and channel pinned by a directed connect, so the next attempt scans all channels.
+ *
+ * A pinned target only pays off on the first attempt. If the AP has moved to another channel
+ * or that BSSID is gone from a multi-AP network, retrying it would never succeed, while an
+ * all-channel scan finds the network wherever it is now. The PMK stays valid for every AP
+ * of the SSID and is kept.
+ */
+void WifiManager::unpinStation() {
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK) return;
+    if (!config.sta.bssid_set && config.sta.channel == 0) return;
+
+    config.sta.bssid_set = false;
+    config.sta.channel = 0;
+    config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    if (esp_wifi_set_config(WIFI_IF_STA, &config) == ESP_OK) {
+        ESP_LOGI(TAG, "Retrying without pinned BSSID/channel");
+    }
+}
+
+/**
+ * @brief Returns the seconds left on a lease, or 0 if it has expired or its age is unknown.
+ *
+ * The RTC keeps time() running across deep sleep and software resets. A power-on, brownout or
+ * EN-pin reset restarts it at zero, so a lease granted before such a reset has no known age.
+ *
+ * @param granted time() in seconds when the lease was granted.
+ * @param seconds Lease duration; UINT32_MAX for an infinite lease.
+ * @return int64_t Seconds left, INT64_MAX for an infinite lease.
+ */
+static int64_t leaseSecondsLeft(int64_t granted, uint32_t seconds) {
+    if (granted == 0 || seconds == 0) return 0;
+    int64_t now = time(nullptr);
+    int64_t boot = now - esp_timer_get_time() / 1000000;
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool clock_kept = reason == ESP_RST_DEEPSLEEP || reason == ESP_RST_SW || reason == ESP_RST_PANIC ||
+                      reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT;
+    if (now < granted || (granted < boot && !clock_kept)) return 0;
+    if (seconds == UINT32_MAX) return INT64_MAX;
+    int64_t left = granted + seconds - now;
+    return left > 0 ? left : 0;
 }
 
-/**
- * @brief Checks if the device is connected to Wi-Fi in Station mode.
- *
- * @return true if connected, false otherwise.
- */
-bool WifiManager::isConnected() const {
-    return m_is_connected;
+/**
+ * @brief Applies the configured IP mode to the station interface before association.
+ *
+ * In static mode, and in reuse-lease mode when an unexpired lease is cached, the DHCP client
+ * is stopped and the address is configured up front, so IP_EVENT_STA_GOT_IP fires as soon as
+ * the link is associated instead of after a full DHCP exchange. A reused lease is handed back
+ * to DHCP when it expires (see expireLease()).
+ *
+ * @param netif The station network interface.
+ */
+void WifiManager::applyIpMode(esp_netif_t* netif) {
+    m_lease_applied = false;
+    m_lease_verifying = false;
+    esp_timer_stop(m_lease_verify_timer);
+    esp_timer_stop(m_lease_expiry_timer);
+
+    const IpSettings* settings = nullptr;
+    if (m_ip_mode == IpMode::Static) {
+        settings = &m_static_ip;
+    } else if (m_ip_mode == IpMode::ReuseLease && m_lease_valid) {
+        int64_t left = leaseSecondsLeft(m_lease_granted, m_lease_seconds);
+        if (left > 0) {
+            settings = &m_lease;
+            m_lease_applied = true;
+            if (left != INT64_MAX) esp_timer_start_once(m_lease_expiry_timer, (uint64_t) left * 1000000);
+        } else {
+            ESP_LOGI(TAG, "Cached lease expired or of unknown age, using DHCP");
+        }
+    }
+    if (!settings) {
+        esp_netif_dhcpc_start(netif);
+        return;
+    }
+
+    esp_netif_dhcpc_stop(netif);
+    if (esp_netif_set_ip_info(netif, &settings->ip_info) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to apply IP configuration, falling back to DHCP");
+        m_lease_applied = false;
+        esp_netif_dhcpc_start(netif);
+        return;
+    }
+    if (settings->dns.addr != 0) {
+        esp_netif_dns_info_t dns = {};
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4 = settings->dns;
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    ESP_LOGI(TAG, "Using %s address " IPSTR, m_lease_applied ? "cached lease" : "static",
+             IP2STR(&settings->ip_info.ip));
+}
+
+/**
+ * @brief Handles ConnectionEvent::AddressAssigned: persists a DHCP lease or starts verifying a reused one.
+ *
+ * A reused lease is not handed to DHCP for confirmation: esp_netif clears the address when its
+ * DHCP client starts, which would take down a link already reported as connected. It is
+ * checked with ARP instead (see verifyLease()).
+ */
+void WifiManager::onAddressAssigned() {
+    if (m_ip_mode == IpMode::Static) return;
+    if (m_lease_applied) {
+        m_lease_applied = false;
+        m_lease_verifying = true;
+        m_lease_probes = 0;
+        verifyLease();
+        return;
+    }
+    esp_netif_ip_info_t ip_info;
+    if (esp_netif_get_ip_info(m_sta_netif, &ip_info) == ESP_OK && ip_info.ip.addr != 0) {
+        saveLease(m_sta_netif, ip_info);
+    }
+}
+
+/**
+ * @struct ArpProbe
+ * @brief Addresses and outcome of one ARP probe round, run in the TCP/IP task.
+ */
+struct ArpProbe {
+    /** @brief Station interface. */
+    esp_netif_t* netif;
+    /** @brief Address taken from the cached lease. */
+    esp_ip4_addr_t address;
+    /** @brief Gateway of the cached lease, 0 if none. */
+    esp_ip4_addr_t gateway;
+    /** @brief Output: another host answered for @ref address. */
+    bool conflict;
+    /** @brief Output: the gateway answered. */
+    bool gateway_seen;
+};
+
+/**
+ * @brief esp_netif_tcpip_exec() callback; reads the ARP replies to the last round and sends the next one.
+ *
+ * @param ctx Pointer to an ArpProbe.
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_STATE if the interface has no lwIP netif.
+ */
+static esp_err_t runArpProbe(void* ctx) {
+    ArpProbe* probe = static_cast<ArpProbe*>(ctx);
+    struct netif* lwip_netif = static_cast<struct netif*>(esp_netif_get_netif_impl(probe->netif));
+    if (!lwip_netif) return ESP_ERR_INVALID_STATE;
+
+    ip4_addr_t address;
+    ip4_addr_t gateway;
+    address.addr = probe->address.addr;
+    gateway.addr = probe->gateway.addr;
+    struct eth_addr* eth = nullptr;
+    const ip4_addr_t* entry = nullptr;
+    // Replies addressed to us are entered into the ARP table; an entry for our own address
+    // can only come from another host using it.
+    probe->conflict = etharp_find_addr(lwip_netif, &address, &eth, &entry) >= 0;
+    probe->gateway_seen = gateway.addr != 0 && etharp_find_addr(lwip_netif, &gateway, &eth, &entry) >= 0;
+
+    etharp_request(lwip_netif, &address);
+    if (gateway.addr != 0) etharp_request(lwip_netif, &gateway);
+    return ESP_OK;
+}
+
+/**
+ * @brief Sends the next ARP probe for a reused lease and evaluates the previous one.
+ *
+ * The cached address stays configured throughout. A host answering for it means the address
+ * was handed out again, so the lease is dropped and DHCP takes over. An answer from the gateway
+ * confirms the lease. If the gateway stays silent for LEASE_VERIFY_PROBES rounds, the cached
+ * address is kept: a slow or quiet network is no reason to make the device unreachable.
+ */
+void WifiManager::verifyLease() {
+    if (!m_lease_verifying) return;
+    if (!isConnected()) {
+        m_lease_verifying = false;
+        return;
+    }
+
+    ArpProbe probe = {};
+    probe.netif = m_sta_netif;
+    probe.address = m_lease.ip_info.ip;
+    probe.gateway = m_lease.ip_info.gw;
+    if (esp_netif_tcpip_exec(&runArpProbe, &probe) != ESP_OK) {
+        ESP_LOGW(TAG, "ARP probe failed, keeping cached lease");
+        m_lease_verifying = false;
+        return;
+    }
+
+    if (probe.conflict) {
+        ESP_LOGW(TAG, "Cached address " IPSTR " is in use by another host, requesting a new lease",
+                 IP2STR(&probe.address));
+        m_lease_verifying = false;
+        m_lease_valid = false;
+        esp_netif_dhcpc_start(m_sta_netif);
+        return;
+    }
+    if (probe.gateway_seen) {
+        ESP_LOGI(TAG, "Cached lease confirmed by gateway " IPSTR, IP2STR(&probe.gateway));
+        m_lease_verifying = false;
+        return;
+    }
+    if (++m_lease_probes >= LEASE_VERIFY_PROBES) {
+        ESP_LOGW(TAG, "Gateway did not answer ARP, keeping cached address " IPSTR, IP2STR(&probe.address));
+        m_lease_verifying = false;
+        return;
+    }
+    esp_timer_start_once(m_lease_verify_timer, (uint64_t) LEASE_VERIFY_INTERVAL_MS * 1000);
+}
+
+/**
+ * @brief esp_timer callback; queues ConnectionEvent::LeaseCheckDue.
+ *
+ * @param arg Pointer to the WifiManager instance.
+ */
+void WifiManager::onLeaseCheckDue(void* arg) {
+    static_cast<WifiManager*>(arg)->postEvent(ConnectionEvent::LeaseCheckDue);
+}
+
+/**
+ * @brief Hands the station interface to the DHCP client once the reused lease has expired.
+ *
+ * Past its expiry the server may give the address to another host, and the ARP check that ran
+ * after association would not notice. Starting the DHCP client drops the address briefly, which
+ * is unavoidable at this point.
+ */
+void WifiManager::expireLease() {
+    esp_netif_dhcp_status_t status;
+    if (m_ip_mode != IpMode::ReuseLease || esp_netif_dhcpc_get_status(m_sta_netif, &status) != ESP_OK ||
+        status == ESP_NETIF_DHCP_STARTED) {
+        return;
+    }
+    ESP_LOGI(TAG, "Cached lease " IPSTR " expired, requesting a new one", IP2STR(&m_lease.ip_info.ip));
+    m_lease_verifying = false;
+    m_lease_valid = false;
+    esp_timer_stop(m_lease_verify_timer);
+    esp_netif_dhcpc_start(m_sta_netif);
+}
+
+/**
+ * @brief esp_timer callback; queues ConnectionEvent::LeaseExpired.
+ *
+ * @param arg Pointer to the WifiManager instance.
+ */
+void WifiManager::onLeaseExpiryDue(void* arg) {
+    static_cast<WifiManager*>(arg)->postEvent(ConnectionEvent::LeaseExpired);
+}
+
+/**
+ * @brief httpd open hook of the provisioning server; registers the session with its station.
+ *
+ * @param handle Server handle.
+ * @param sockfd Socket of the new session.
+ * @return esp_err_t ESP_OK to accept the session, ESP_FAIL to close it.
+ */
+esp_err_t WifiManager::onSessionOpen(httpd_handle_t handle, int sockfd) {
+    WifiManager* self = static_cast<WifiManager*>(httpd_get_global_user_ctx(handle));
+
+    // The server socket is dual-stack, so IPv4 peers appear as IPv4-mapped IPv6 addresses.
+    struct sockaddr_storage peer = {};
+    socklen_t peer_len = sizeof(peer);
+    uint32_t address = 0;
+    if (getpeername(sockfd, (struct sockaddr*) &peer, &peer_len) == 0) {
+        if (peer.ss_family == AF_INET) {
+            address = ((struct sockaddr_in*) &peer)->sin_addr.s_addr;
+        } else if (peer.ss_family == AF_INET6) {
+            memcpy(&address, &((struct sockaddr_in6*) &peer)->sin6_addr.s6_addr[12], sizeof(address));
+        }
+    }
+    return self->m_clients.onOpen(sockfd, address) ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief httpd close hook of the provisioning server; unregisters and closes the session.
+ *
+ * With a close hook installed httpd leaves closing the socket to the hook.
+ *
+ * @param handle Server handle.
+ * @param sockfd Socket of the session.
+ */
+void WifiManager::onSessionClose(httpd_handle_t handle, int sockfd) {
+    WifiManager* self = static_cast<WifiManager*>(httpd_get_global_user_ctx(handle));
+    self->m_clients.onClose(sockfd);
+    close(sockfd);
+}
+
+/**
+ * @brief esp_timer callback closing provisioning sessions that have been idle too long.
+ *
+ * A client that keeps sockets open without sending requests would otherwise hold slots
+ * until LRU purging, which only kicks in once every slot is taken.
+ *
+ * esp_timer_stop() does not wait for a running callback, so the server handle is only used
+ * under @ref m_server_mutex. If the server is being started or stopped the round is skipped
+ * rather than blocking the esp_timer task.
+ *
+ * @param arg Pointer to the WifiManager instance.
+ */
+void WifiManager::idleSessionCheck(void* arg) {
+    WifiManager* self = static_cast<WifiManager*>(arg);
+    if (xSemaphoreTake(self->m_server_mutex, 0) != pdTRUE) return;
+
+    if (self->m_server && self->m_server_provisioning) {
+        int idle[ProvisioningClientTracker::SESSION_CAPACITY];
+        size_t count = self->m_clients.collectIdle(idle, ProvisioningClientTracker::SESSION_CAPACITY);
+        for (size_t i = 0; i < count; i++) {
+            ESP_LOGI(TAG, "Closing idle session %d", idle[i]);
+            httpd_sess_trigger_close(self->m_server, idle[i]);
+        }
+    }
+    xSemaphoreGive(self->m_server_mutex);
+}
+
+/**
+ * @brief Charges a request to its station's budget; answers 429 if the budget is exhausted.
+ *
+ * @param req HTTP request handle.
+ * @return true if the handler may serve the request, false if it has been answered already.
+ */
+bool WifiManager::admitRequest(httpd_req_t* req) {
+    if (m_clients.admit(httpd_req_to_sockfd(req))) return true;
+
+    char retry_after[8];
+    snprintf(retry_after, sizeof(retry_after), "%d", PROV_CLIENT_BUDGET_WINDOW_MS / 1000);
+    httpd_resp_set_status(req, "429 Too Many Requests");
+    httpd_resp_set_hdr(req, "Retry-After", retry_after);
+    httpd_resp_send(req, NULL, 0);
+    return false;
+}
+
+/**
+ * @brief Starts Access Point mode for provisioning.
+ *
+ * Configures and starts an AP with a web server to receive new Wi-Fi credentials, and a DNS
+ * responder pointing every name at the AP so clients open the page as a captive portal.
+ * The AP is moved to the least congested non-overlapping channel found by a quick scan.
+ */
+void WifiManager::startProvisioning() {
+    stopWebServer();
+
+    wifi_config_t wifi_config = {};
+    strncpy((char*)wifi_config.ap.ssid, PROV_AP_SSID, sizeof(wifi_config.ap.ssid));
+    strncpy((char*)wifi_config.ap.password, PROV_AP_PASS, sizeof(wifi_config.ap.password));
+    wifi_config.ap.ssid_len = strlen(PROV_AP_SSID);
+    wifi_config.ap.authmode = WIFI_AUTH_WPA_WPA2_PSK;
+    wifi_config.ap.max_connection = PROV_AP_MAX_CONN;
+    wifi_config.ap.channel = PROV_AP_DEFAULT_CHANNEL;
+
+    // Configured before the driver starts, so its default open network is never beaconed.
+    switchMode(WIFI_MODE_APSTA, false, &wifi_config);
+    esp_wifi_set_inactive_time(WIFI_IF_AP, PROV_AP_INACTIVE_TIME_S);
+#if PROV_AP_AUTO_CHANNEL
+    // The channel scan needs the running driver, so the AP moves there afterwards.
+    uint8_t channel = selectProvisioningChannel();
+    if (channel != wifi_config.ap.channel) {
+        wifi_config.ap.channel = channel;
+        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
+    }
+#endif
+
+    esp_netif_ip_info_t ip_info;
+    esp_netif_get_ip_info(m_ap_netif, &ip_info);
+    ESP_LOGI(TAG, "AP started. SSID: '%s', Connect to http://" IPSTR, PROV_AP_SSID, IP2STR(&ip_info.ip));
+
+    snprintf(m_portal_url, sizeof(m_portal_url), "http://" IPSTR "/", IP2STR(&ip_info.ip));
+
+    // Offer the AP itself as DNS server so every lookup reaches the captive responder.
+    esp_netif_dns_info_t dns = {};
+    dns.ip.type = ESP_IPADDR_TYPE_V4;
+    dns.ip.u_addr.ip4 = ip_info.ip;
+    uint8_t offer_dns = 0x02;  // OFFER_DNS
+    esp_netif_dhcps_stop(m_ap_netif);
+    esp_netif_set_dns_info(m_ap_netif, ESP_NETIF_DNS_MAIN, &dns);
+    esp_netif_dhcps_option(m_ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_DOMAIN_NAME_SERVER, &offer_dns, sizeof(offer_dns));
+    esp_netif_dhcps_start(m_ap_netif);
+
+    if (m_dns.start(ip_info.ip) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start captive-portal DNS responder");
+    }
+    // Mount (and fill the cache) now rather than on the first page request, which would otherwise
+    // pay for it; not needed if the page is served from the asset partition.
+    bool mapped = false;
+#if FLASH_ASSETS_ENABLED
+    mapped = m_flash_assets.begin() == ESP_OK;
+#endif
+    if (!mapped) {
+        if (m_fs.ensureMounted() != ESP_OK) {
+            ESP_LOGW(TAG, "Filesystem unavailable, provisioning page cannot be served");
+        }
+#if ASSET_CACHE_ENABLED
+        m_assets.load();
+#endif
+    }
+    startWebServer(true);
 }
 
 /**
- * @brief Retrieves the current IP address in Station mode.
+ * @brief Rates how congested a 20 MHz channel is.
  *
- * @return std::string containing the IP address, or empty if not connected.
+ * Every AP within four channels overlaps; its contribution is PROV_CHANNEL_AP_WEIGHT plus
+ * its signal above -100 dBm, scaled by how much of the channel it overlaps (100% on the same
+ * channel, 20% four channels away). Lower is better.
+ *
+ * @param records Scan results.
+ * @param count Number of entries in @p records.
+ * @param channel Channel to rate.
+ * @return uint32_t Congestion score.
  */
-std::string WifiManager::getIpAddress() const {
-    return m_current_ip;
+static uint32_t channelCongestion(const wifi_ap_record_t* records, size_t count, uint8_t channel) {
+    uint32_t score = 0;
+    for (size_t i = 0; i < count; i++) {
+        int distance = abs((int) records[i].primary - (int) channel);
+        if (distance > 4) continue;
+        int signal = records[i].rssi + 100;
+        if (signal < 0) signal = 0;
+        score += (uint32_t) ((PROV_CHANNEL_AP_WEIGHT + signal) * (5 - distance) / 5);
+    }
+    return score;
 }
 
 /**
- * @brief Starts the Wi-Fi management process.
+ * @brief Scans all channels and returns the least congested of channels 1, 6 and 11.
+ *
+ * Hidden networks are included since they occupy the channel all the same. The results
+ * also refresh @ref m_scan_cache, so SSID suggestions are available right away.
  *
- * Attempts to connect using stored credentials. If connection fails or no credentials
- * are available, switches to provisioning mode (AP).
+ * @return uint8_t The channel for the provisioning AP.
  */
-void WifiManager::start() {
-    initialize();
-
-    std::string saved_ssid, saved_pass;
-    if (loadCredentials(saved_ssid, saved_pass) == ESP_OK) {
-        ESP_LOGI(TAG, "Found credentials, connecting to '%s'", saved_ssid.c_str());
-        connectToWifi(saved_ssid, saved_pass);
-        
-        EventBits_t bits = xEventGroupWaitBits(m_wifi_event_group,
-                                               WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-                                               pdFALSE,
-                                               pdFALSE,
-                                               pdMS_TO_TICKS(30000));
-
-        if (bits & WIFI_CONNECTED_BIT) {
-            startWebServer(false);
-            return;
-        } 
-        ESP_LOGW(TAG, "Failed to connect with stored credentials");
+uint8_t WifiManager::selectProvisioningChannel() {
+    static constexpr uint8_t CHANNELS[] = {1, 6, 11};
+
+    wifi_scan_config_t scan_config = {};
+    scan_config.show_hidden = true;
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.min = SCAN_CHANNEL_DWELL_MS;
+    scan_config.scan_time.active.max = SCAN_CHANNEL_DWELL_MS;
+
+    int64_t start_us = esp_timer_get_time();
+    if (esp_wifi_scan_start(&scan_config, true) != ESP_OK) {
+        ESP_LOGW(TAG, "Channel scan failed, using channel %d", PROV_AP_DEFAULT_CHANNEL);
+        return PROV_AP_DEFAULT_CHANNEL;
     }
-    
-    startProvisioning();
+    uint16_t record_count = PROV_CHANNEL_SCAN_MAX_RECORDS;
+    std::vector<wifi_ap_record_t> records(record_count);
+    esp_wifi_scan_get_ap_records(&record_count, records.data());
+    m_scan_cache.update(records.data(), record_count);
+
+    uint32_t scores[sizeof(CHANNELS)];
+    size_t best = 0;
+    for (size_t i = 0; i < sizeof(CHANNELS); i++) {
+        scores[i] = channelCongestion(records.data(), record_count, CHANNELS[i]);
+        if (scores[i] < scores[best]) best = i;
+    }
+    ESP_LOGI(TAG, "SoftAP channel %d (score %" PRIu32 "; 1: %" PRIu32 ", 6: %" PRIu32 ", 11: %" PRIu32 ", %d AP(s), scan %" PRId64 " ms)",
+             CHANNELS[best], scores[best], scores[0], scores[1], scores[2], record_count,
+             (esp_timer_get_time() - start_us) / 1000);
+    return CHANNELS[best];
 }
 
 /**
- * @brief Connects to a Wi-Fi Access Point with provided credentials.
+ * @brief Switches the Wi-Fi driver to the given mode in place.
  *
- * @param ssid The SSID of the Wi-Fi network.
- * @param password The password of the Wi-Fi network.
- * @return esp_err_t ESP_OK if connection attempt starts successfully, ESP_FAIL otherwise.
+ * Cancels pending reconnects and, unless @p keep_station is set, drops the current station
+ * association, then changes only the mode; the driver and both netifs stay alive. The
+ * driver is started on first use. Heap figures are logged around the switch to track
+ * fragmentation.
+ *
+ * @param mode The target Wi-Fi mode.
+ * @param keep_station If true, an existing station association is kept (e.g. APSTA -> STA).
+ * @param ap_config Optional SoftAP configuration, applied after the mode change and before
+ *                  esp_wifi_start(), so a freshly started AP beacons it from the first frame.
  */
-esp_err_t WifiManager::connectToWifi(const std::string& ssid, const std::string& password) {
-    if (ssid.empty()) {
-        ESP_LOGE(TAG, "SSID cannot be empty");
-        return ESP_ERR_INVALID_ARG;
-    }
+void WifiManager::switchMode(wifi_mode_t mode, bool keep_station, const wifi_config_t* ap_config) {
+    logHeapFragmentation("before mode switch");
+    int64_t start_us = esp_timer_get_time();
 
-    stopWifi(); 
-    
-    esp_netif_create_default_wifi_sta();
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    m_reconnect.cancel();
+    wifi_mode_t current = WIFI_MODE_NULL;
+    esp_wifi_get_mode(&current);
 
-    wifi_config_t wifi_config = {};
-    strncpy((char*)wifi_config.sta.ssid, ssid.c_str(), sizeof(wifi_config.sta.ssid));
-    if (ssid.length() < sizeof(wifi_config.sta.ssid)) {
-        wifi_config.sta.ssid[ssid.length()] = '\0';
+    if (!keep_station && m_wifi_started && (current == WIFI_MODE_STA || current == WIFI_MODE_APSTA)) {
+        wifi_ap_record_t ap_info;
+        m_local_disconnect = (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK);
+        esp_wifi_disconnect();
     }
-    strncpy((char*)wifi_config.sta.password, password.c_str(), sizeof(wifi_config.sta.password));
-    if (password.length() < sizeof(wifi_config.sta.password)) {
-        wifi_config.sta.password[password.length()] = '\0';
+    if (current != mode) {
+        ESP_ERROR_CHECK(esp_wifi_set_mode(mode));
+    }
+    if (ap_config) {
+        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, const_cast<wifi_config_t*>(ap_config)));
+    }
+    if (!m_wifi_started) {
+        ESP_ERROR_CHECK(esp_wifi_start());
+        m_wifi_started = true;
     }
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
-
-    return ESP_OK;
+    ESP_LOGI(TAG, "Mode switch %d -> %d took %" PRId64 " ms", current, mode, (esp_timer_get_time() - start_us) / 1000);
+    logHeapFragmentation("after mode switch");
 }
 
 /**
- * @brief Starts Access Point mode for provisioning.
+ * @brief All routes of the web server, registered in order by startWebServer().
  *
- * Configures and starts an AP with a web server to receive new Wi-Fi credentials.
+ * The captive portal probes are URIs requested by operating systems to detect a captive portal.
+ * Android and ChromeOS expect a 204, Apple and Windows expect fixed bodies; a redirect to the
+ * provisioning page instead makes each of them show its sign-in prompt and keep the link up.
  */
-void WifiManager::startProvisioning() {
-    stopWifi();
-
-    esp_netif_create_default_wifi_ap();
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    wifi_config_t wifi_config = {};
-    strncpy((char*)wifi_config.ap.ssid, PROV_AP_SSID, sizeof(wifi_config.ap.ssid));
-    strncpy((char*)wifi_config.ap.password, PROV_AP_PASS, sizeof(wifi_config.ap.password));
-    wifi_config.ap.ssid_len = strlen(PROV_AP_SSID);
-    wifi_config.ap.authmode = WIFI_AUTH_WPA_WPA2_PSK;
-    wifi_config.ap.max_connection = PROV_AP_MAX_CONN;
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
-
-    esp_netif_ip_info_t ip_info;
-    esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_AP_DEF"), &ip_info);
-    ESP_LOGI(TAG, "AP started. SSID: '%s', Connect to http://" IPSTR, PROV_AP_SSID, IP2STR(&ip_info.ip));
-
-    startWebServer(true);
-}
+constexpr WifiManager::Route WifiManager::ROUTES[] = {
+    {"/", HTTP_GET, provisioningGetHandler, ROUTE_PROVISIONING},
+    {"/connect", HTTP_POST, connectPostHandler, ROUTE_PROVISIONING},
+    {"/connect", HTTP_GET, connectStatusGetHandler, ROUTE_PROVISIONING},
+    {"/scan", HTTP_GET, scanGetHandler, ROUTE_PROVISIONING},
+    {"/static/*", HTTP_GET, staticGetHandler, ROUTE_PROVISIONING},
+    {"/reset", HTTP_GET, resetGetHandler, ROUTE_STATION},
+    {"/status", HTTP_GET, statusGetHandler, ROUTE_BOTH},
+    {"/favicon.ico", HTTP_GET, faviconGetHandler, ROUTE_BOTH},
+    // Captive portal probes
+    {"/generate_204", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},               // Android, ChromeOS
+    {"/gen_204", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},                    // Android
+    {"/hotspot-detect.html", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},        // Apple
+    {"/library/test/success.html", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},  // Apple (older releases)
+    {"/connecttest.txt", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},            // Windows 10+
+    {"/ncsi.txt", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},                   // Windows 7/8
+    {"/redirect", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},                   // Windows
+    {"/canonical.html", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},             // Firefox
+    {"/success.txt", HTTP_GET, captivePortalRedirectHandler, ROUTE_PROVISIONING},                // Firefox
+};
 
 /**
- * @brief Stops Wi-Fi in AP and/or STA mode.
+ * @brief Counts the routes registered on a server.
  *
- * Stops the web server, Wi-Fi, and destroys network interfaces.
+ * @param mode ROUTE_PROVISIONING or ROUTE_STATION.
+ * @return size_t Number of entries of ROUTES with @p mode set.
  */
-void WifiManager::stopWifi() {
-    stopWebServer();
-    esp_wifi_stop();
-    esp_wifi_deinit();
-    esp_netif_t* netif_sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    if (netif_sta) esp_netif_destroy(netif_sta);
-    esp_netif_t* netif_ap = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
-    if (netif_ap) esp_netif_destroy(netif_ap);
+constexpr size_t WifiManager::routeCount(uint8_t mode) {
+    size_t count = 0;
+    for (const Route& route : ROUTES) {
+        if (route.modes & mode) count++;
+    }
+    return count;
 }
 
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+// httpd needs three sockets of its own, the captive DNS responder one.
+static_assert(PROV_HTTPD_MAX_SOCKETS + 3 + 1 <= CONFIG_LWIP_MAX_SOCKETS,
+              "PROV_AP_MAX_CONN * PROV_HTTPD_SOCKETS_PER_CLIENT exceeds CONFIG_LWIP_MAX_SOCKETS");
+#endif
+
 /**
  * @brief Starts the HTTP web server.
  *
- * @param is_provisioning_mode True for AP provisioning mode, false for STA mode (reset endpoint only).
+ * Registers the entries of ROUTES whose mode mask includes the requested server.
+ *
+ * @param is_provisioning_mode True for AP provisioning mode, false for the STA control server.
  */
 void WifiManager::startWebServer(bool is_provisioning_mode) {
-    if (m_server) return;
+    xSemaphoreTake(m_server_mutex, portMAX_DELAY);
+    if (m_server && is_provisioning_mode && !m_server_provisioning) {
+        httpd_stop(m_server);
+        m_server = nullptr;
+    }
+    if (m_server) {
+        xSemaphoreGive(m_server_mutex);
+        return;
+    }
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
     config.lru_purge_enable = true;
+    // Sized from the route table, so httpd allocates exactly the handler slots this server uses.
+    static constexpr size_t PROVISIONING_ROUTES = routeCount(ROUTE_PROVISIONING);
+    static constexpr size_t STATION_ROUTES = routeCount(ROUTE_STATION);
+    static_assert(PROVISIONING_ROUTES <= UINT16_MAX && STATION_ROUTES <= UINT16_MAX, "Too many routes for max_uri_handlers");
+    config.max_uri_handlers = is_provisioning_mode ? PROVISIONING_ROUTES : STATION_ROUTES;
+    config.global_user_ctx = this;
+    config.global_user_ctx_free_fn = [](void*) {};  // owned by the caller, must not be freed by httpd_stop()
+    if (is_provisioning_mode) {
+        config.max_open_sockets = PROV_HTTPD_MAX_SOCKETS;
+        config.recv_wait_timeout = PROV_HTTPD_IO_TIMEOUT_S;
+        config.send_wait_timeout = PROV_HTTPD_IO_TIMEOUT_S;
+        config.open_fn = onSessionOpen;
+        config.close_fn = onSessionClose;
+        m_clients.reset();
+    }
 
     if (httpd_start(&m_server, &config) == ESP_OK) {
+        uint8_t mode = is_provisioning_mode ? ROUTE_PROVISIONING : ROUTE_STATION;
+        for (const Route& route : ROUTES) {
+            if (!(route.modes & mode)) continue;
+            httpd_uri_t uri = {.uri = route.uri, .method = route.method, .handler = route.handler, .user_ctx = this };
+            esp_err_t ret = httpd_register_uri_handler(m_server, &uri);
+            if (ret != ESP_OK) ESP_LOGE(TAG, "Failed to register %s (%s)", route.uri, esp_err_to_name(ret));
+        }
         if (is_provisioning_mode) {
-            httpd_uri_t root_uri = {.uri = "/", .method = HTTP_GET, .handler = provisioningGetHandler, .user_ctx = this };
-            httpd_register_uri_handler(m_server, &root_uri);
-            httpd_uri_t connect_uri = {.uri = "/connect", .method = HTTP_POST, .handler = connectPostHandler, .user_ctx = this };
-            httpd_register_uri_handler(m_server, &connect_uri);
-        } else {
-            httpd_uri_t reset_uri = {.uri = "/reset", .method = HTTP_GET, .handler = resetGetHandler, .user_ctx = this };
-            httpd_register_uri_handler(m_server, &reset_uri);
+            httpd_register_err_handler(m_server, HTTPD_404_NOT_FOUND, notFoundRedirectHandler);
+            esp_timer_start_periodic(m_idle_session_timer, (uint64_t) PROV_CLIENT_IDLE_CHECK_MS * 1000);
         }
-        httpd_uri_t favicon_uri = {.uri = "/favicon.ico", .method = HTTP_GET, .handler = faviconGetHandler, .user_ctx = this };
-        httpd_register_uri_handler(m_server, &favicon_uri);
+        m_server_provisioning = is_provisioning_mode;
+        ESP_LOGI(TAG, "%s server started", is_provisioning_mode ? "Provisioning" : "Control");
     } else {
         ESP_LOGE(TAG, "Failed to start web server");
     }
+    xSemaphoreGive(m_server_mutex);
 }
 
 /**
  * @brief Stops the HTTP web server.
+ *
+ * @param control_only True to stop the server only if it is the station-mode control server.
  */
-void WifiManager::stopWebServer() {
-    if (m_server) {
+void WifiManager::stopWebServer(bool control_only) {
+    xSemaphoreTake(m_server_mutex, portMAX_DELAY);
+    if (m_server && !(control_only && m_server_provisioning)) {
+        if (m_idle_session_timer) esp_timer_stop(m_idle_session_timer);
         httpd_stop(m_server);
         m_server = nullptr;
     }
+    xSemaphoreGive(m_server_mutex);
 }
 
 /**
@@ -241,80 +1522,188 @@ void WifiManager::stopWebServer() {
 void WifiManager::eventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
     WifiManager* self = static_cast<WifiManager*>(arg);
 
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        if (self->m_background_scan) {
+            self->collectBackgroundScan();
+        } else {
+            self->m_roaming.onScanDone();
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_BSS_RSSI_LOW) {
+        wifi_event_bss_rssi_low_t* event = (wifi_event_bss_rssi_low_t*) event_data;
+        self->m_link.modify([event](LinkStatus& link) { link.rssi = (int8_t) event->rssi; });
+        self->m_roaming.onRssiLow(event->rssi);
+#if CONFIG_ESP_WIFI_11KV_SUPPORT
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_NEIGHBOR_REP) {
+        wifi_event_neighbor_report_t* event = (wifi_event_neighbor_report_t*) event_data;
+        self->m_roaming.onNeighborReport(event->report, event->report_len);
+#endif
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        self->m_link.modify([event](LinkStatus& link) {
+            memcpy(link.bssid, event->bssid, sizeof(link.bssid));
+            link.channel = event->channel;
+        });
+        self->m_sta_associated = true;
+        self->m_timings.onAssociated(event->channel);
+        if (self->m_roaming.onConnected(event->bssid)) {
+            self->publishLinkEvent(LinkEventPublisher::Type::Roamed);
+        }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (self->m_retry_num < MAX_RETRY) {
-            esp_wifi_connect();
-            self->m_retry_num++;
+        wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
+        if (self->m_roaming.onDisconnected(event->reason)) return;
+        self->m_sta_associated = false;
+        if (event->reason == WIFI_REASON_ASSOC_LEAVE && self->m_local_disconnect.exchange(false)) return;
+        bool was_connected = self->m_link.read().connected;
+        self->m_link.modify([](LinkStatus& link) {
+            link.connected = false;
+            link.ip.addr = 0;
+            link.rssi = 0;
+        });
+        if (was_connected) {
+            self->publishLinkEvent(LinkEventPublisher::Type::Down, event->reason);
+        }
+        self->m_timings.onFailed(event->reason);
+        if (self->m_fast_connect_active.exchange(false)) {
+            if (self->m_validating) self->m_validation_result = classifyValidationFailure(event->reason);
+            self->postEvent(ConnectionEvent::AttemptFailed);
+        } else if (self->m_reconnect.schedule(event->reason)) {
+            self->postEvent(ConnectionEvent::Disconnected);
         } else {
-            self->m_is_connected = false;
-            xEventGroupSetBits(self->m_wifi_event_group, WIFI_FAIL_BIT);
+            self->postEvent(ConnectionEvent::AttemptFailed);
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        char ip_str[16];
-        snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&event->ip_info.ip));
-        self->m_current_ip = ip_str;
-        self->m_retry_num = 0;
-        self->m_is_connected = true;
-        xEventGroupSetBits(self->m_wifi_event_group, WIFI_CONNECTED_BIT);
+        int64_t connect_start_us = self->m_connect_start_us.exchange(0);
+        if (connect_start_us != 0) {
+            self->m_time_to_ip_us = esp_timer_get_time() - connect_start_us;
+        }
+        self->m_timings.onGotIp();
+        self->m_reconnect.onConnected();
+        self->m_fast_connect_active = false;
+        wifi_ap_record_t ap_info;
+        int8_t rssi = (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) ? ap_info.rssi : 0;
+        LinkStatus previous = self->m_link.read();
+        self->m_link.modify([event, rssi](LinkStatus& link) {
+            link.connected = true;
+            link.ip = event->ip_info.ip;
+            link.rssi = rssi;
+        });
+        // Lease bookkeeping writes NVS, which does not belong on the event loop.
+        self->postEvent(ConnectionEvent::AddressAssigned);
+        if (!previous.connected) {
+            self->publishLinkEvent(LinkEventPublisher::Type::Up);
+            self->postEvent(ConnectionEvent::GotIp);
+        } else if (previous.ip.addr != event->ip_info.ip.addr) {
+            self->publishLinkEvent(LinkEventPublisher::Type::IpChanged);
+        }
     }
 }
 
 /**
  * @brief HTTP GET handler for serving the provisioning page.
  *
- * Serves the index.html file from LittleFS.
+ * Serves index.html straight from the memory-mapped asset partition if it holds the page,
+ * else from the asset cache with a single send, else streams it from LittleFS with the
+ * FileStreamer (mounting the filesystem on first use). Each way the gzip variant is sent
+ * with Content-Encoding: gzip if the client accepts it and it exists. The log line tags the
+ * serve time with its source, so the three paths can be compared.
  *
  * @param req HTTP request handle.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
 esp_err_t WifiManager::provisioningGetHandler(httpd_req_t *req) {
-    const char* filepath = LFS_BASE_PATH "/index.html";
-    
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
+
+    int64_t start_us = esp_timer_get_time();
+#if FLASH_ASSETS_ENABLED
+    esp_err_t mapped = self->m_flash_assets.send(req, "/index.html");
+    if (mapped != ESP_ERR_NOT_FOUND) {
+        if (mapped != ESP_OK) return ESP_FAIL;
+        FlashAssetStore::Stats flash = self->m_flash_assets.getStats();
+        self->logServe("flash", start_us, flash.bytes_sent, flash.send_us);
+        return ESP_OK;
+    }
+#endif
+#if ASSET_CACHE_ENABLED
+    esp_err_t cached = self->m_assets.send(req, "/index.html");
+    if (cached != ESP_ERR_NOT_FOUND) {
+        if (cached != ESP_OK) return ESP_FAIL;
+        AssetCache::Stats assets = self->m_assets.getStats();
+        self->logServe("cache", start_us, assets.bytes_sent, 0);
+        return ESP_OK;
+    }
+#endif
+    if (self->m_fs.ensureMounted() != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    const char* filepath = LFS_BASE_PATH "/index.html.gz";
     struct stat st;
-    if (stat(filepath, &st) != 0) {
+    bool gzip = AssetCache::acceptsGzip(req) && stat(filepath, &st) == 0;
+    if (!gzip) filepath = LFS_BASE_PATH "/index.html";
+
+    if (!gzip && stat(filepath, &st) != 0) {
         ESP_LOGE(TAG, "index.html not found in %s", LFS_BASE_PATH);
         httpd_resp_send_404(req);
         return ESP_FAIL;
     }
 
-    int fd = open(filepath, O_RDONLY, 0);
-    if (fd == -1) {
-        ESP_LOGE(TAG, "Failed to open index.html");
+    // FileStreamer writes the header block itself: headers go in the Response, since values
+    // set with httpd_resp_set_hdr() would be dropped.
+    FileStreamer::Response response;
+    response.type = "text/html";
+    response.encoding = gzip ? "gzip" : nullptr;
+    esp_err_t ret = self->m_streamer.sendFile(req, filepath, response);
+    if (ret == ESP_ERR_NOT_FOUND || ret == ESP_ERR_NO_MEM) {
+        ESP_LOGE(TAG, "Failed to send index.html: %s", esp_err_to_name(ret));
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
+    if (ret != ESP_OK) return ESP_FAIL;
+    self->m_littlefs_bytes_sent += (uint32_t) st.st_size;
 
-    httpd_resp_set_type(req, "text/html");
-
-    char buffer[256];
-    ssize_t bytes_read;
-    while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0) {
-        if (httpd_resp_send_chunk(req, buffer, bytes_read) != ESP_OK) {
-            close(fd);
-            return ESP_FAIL;
-        }
-    }
-    
-    close(fd);
-    httpd_resp_send_chunk(req, NULL, 0);
+    self->m_littlefs_serve_us += (uint64_t) (esp_timer_get_time() - start_us);
+    self->logServe("LittleFS", start_us, self->m_littlefs_bytes_sent, self->m_littlefs_serve_us);
     return ESP_OK;
 }
 
+/**
+ * @brief Records and logs the serve time of the provisioning page.
+ *
+ * Logs the duration of this request and, if @p total_us is known, the throughput over all
+ * requests served from the same source, so the flash, cache and LittleFS paths can be compared.
+ *
+ * @param source Where the page came from ("flash", "cache" or "LittleFS").
+ * @param start_us esp_timer timestamp at which the request was accepted.
+ * @param total_bytes Body bytes sent from this source so far.
+ * @param total_us Time spent sending them, or 0 if not measured.
+ */
+void WifiManager::logServe(const char* source, int64_t start_us, uint32_t total_bytes, uint64_t total_us) {
+    uint32_t duration_us = (uint32_t) (esp_timer_get_time() - start_us);
+    size_t clients = m_clients.recordServe(duration_us);
+    uint32_t kib_per_s = total_us ? (uint32_t) ((uint64_t) total_bytes * 1000000 / 1024 / total_us) : 0;
+    ESP_LOGI(TAG, "Served index.html from %s in %" PRIu32 " us (%u active clients, %" PRIu32 " bytes from %s so far, %" PRIu32 " KiB/s)",
+             source, duration_us, (unsigned) clients, total_bytes, source, kib_per_s);
+}
+
 /**
  * @brief HTTP POST handler for receiving Wi-Fi credentials.
  *
- * Saves credentials and restarts the device to attempt connection.
+ * Queues the credentials for a live attempt in APSTA mode while the provisioning AP stays
+ * up and answers 202 {"result":"pending"} at once, so the single httpd task stays free for
+ * the other clients. The page then polls GET /connect for the outcome. The network is added
+ * to the credential store only once it obtains an IP; the AP is then shut down without a
+ * restart.
  *
  * @param req HTTP request handle.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
 esp_err_t WifiManager::connectPostHandler(httpd_req_t *req) {
     WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
     
-    char buf[128];
+    char buf[256];
     int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
     if (ret <= 0) {
         if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
@@ -324,24 +1713,143 @@ esp_err_t WifiManager::connectPostHandler(httpd_req_t *req) {
     }
     buf[ret] = '\0';
 
-    char ssid[33] = {0};
-    char pass[65] = {0};
+    CredentialStore::Network network = {};
     
-    if (httpd_query_key_value(buf, "ssid", ssid, sizeof(ssid)) != ESP_OK) {
+    if (httpd_query_key_value(buf, "ssid", network.ssid, sizeof(network.ssid)) != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing 'ssid' parameter");
         return ESP_FAIL;
     }
-    httpd_query_key_value(buf, "password", pass, sizeof(pass));
+    httpd_query_key_value(buf, "password", network.password, sizeof(network.password));
 
-    const char *resp_str = "<h1>Connecting...</h1><p>If successful, the device will connect to the network. If failed, it will remain in provisioning mode.</p>";
-    httpd_resp_send(req, resp_str, HTTPD_RESP_USE_STRLEN);
+    char field[16] = {0};
+    if (httpd_query_key_value(buf, "priority", field, sizeof(field)) == ESP_OK) {
+        network.priority = (uint8_t) atoi(field);
+    }
+    network.ip_mode = IpMode::Dhcp;
+    if (httpd_query_key_value(buf, "ip_mode", field, sizeof(field)) == ESP_OK) {
+        if (strcmp(field, "static") == 0) {
+            network.ip_mode = IpMode::Static;
+        } else if (strcmp(field, "reuse") == 0) {
+            network.ip_mode = IpMode::ReuseLease;
+        }
+    }
+    if (network.ip_mode == IpMode::Static) {
+        const struct { const char* key; esp_ip4_addr_t* addr; bool required; } fields[] = {
+            {"static_ip", &network.static_ip.ip_info.ip,      true},
+            {"netmask",   &network.static_ip.ip_info.netmask, true},
+            {"gateway",   &network.static_ip.ip_info.gw,      false},
+            {"dns",       &network.static_ip.dns,             false},
+        };
+        for (const auto& f : fields) {
+            if (httpd_query_key_value(buf, f.key, field, sizeof(field)) != ESP_OK || field[0] == '\0') {
+                if (!f.required) continue;
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Static mode requires 'static_ip' and 'netmask'");
+                return ESP_FAIL;
+            }
+            if (esp_netif_str_to_ip4(field, f.addr) != ESP_OK) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid IPv4 address");
+                return ESP_FAIL;
+            }
+        }
+    }
 
-    self->saveCredentials(ssid, pass);
-    
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    esp_restart();
+    httpd_resp_set_type(req, "application/json");
+    if (!self->requestValidation(network)) {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_send(req, "{\"result\":\"busy\"}", HTTPD_RESP_USE_STRLEN);
+    }
 
-    return ESP_OK;
+    httpd_resp_set_status(req, "202 Accepted");
+    return httpd_resp_send(req, "{\"result\":\"pending\"}", HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief HTTP GET handler reporting the outcome of the last submitted credentials as JSON.
+ *
+ * Answers e.g. {"result":"success","ip":"192.168.1.20"}; "result" stays "pending" while
+ * the attempt runs, and "ip" is 0.0.0.0 unless it succeeded. The first delivery of a success
+ * moves the AP shutdown to PROV_HANDOFF_DELAY_MS from now.
+ *
+ * @param req HTTP request handle.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t WifiManager::connectStatusGetHandler(httpd_req_t *req) {
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
+
+    ValidationResult result = self->m_validating ? ValidationResult::Pending : self->m_validation_result.load();
+    esp_ip4_addr_t ip = {};
+    if (result == ValidationResult::Success) ip = self->getIpAddress();
+    char resp_str[64];
+    snprintf(resp_str, sizeof(resp_str), "{\"result\":\"%s\",\"ip\":\"" IPSTR "\"}", validationResultToString(result),
+             IP2STR(&ip));
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = httpd_resp_send(req, resp_str, HTTPD_RESP_USE_STRLEN);
+    if (ret == ESP_OK && result == ValidationResult::Success && self->m_handoff_pending.exchange(false)) {
+        esp_timer_stop(self->m_handoff_timer);
+        esp_timer_start_once(self->m_handoff_timer, (uint64_t) PROV_HANDOFF_DELAY_MS * 1000);
+    }
+    return ret;
+}
+
+/**
+ * @brief Writes @p in as the body of a JSON string, escaping quotes, backslashes and control characters.
+ *
+ * @param in Null-terminated input.
+ * @param out Output buffer; always null-terminated.
+ * @param size Size of @p out. Six bytes per input byte suffice for any input.
+ */
+static void jsonEscape(const char* in, char* out, size_t size) {
+    size_t n = 0;
+    for (; *in && n + 7 < size; in++) {
+        unsigned char c = (unsigned char) *in;
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = (char) c;
+        } else if (c < 0x20) {
+            n += snprintf(out + n, size - n, "\\u%04x", c);
+        } else {
+            out[n++] = (char) c;
+        }
+    }
+    out[n] = '\0';
+}
+
+/**
+ * @brief HTTP GET handler streaming the scan cache as a JSON array.
+ *
+ * Each access point is written as its own chunk from a stack buffer, e.g.
+ * {"ssid":"Home","bssid":"aa:bb:cc:dd:ee:ff","rssi":-52,"channel":6,"auth":3,"age":4},
+ * where "auth" is the wifi_auth_mode_t value and "age" the seconds since the last sighting.
+ * The document is never assembled in heap.
+ *
+ * @param req HTTP request handle.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t WifiManager::scanGetHandler(httpd_req_t *req) {
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    if (httpd_resp_send_chunk(req, "[", 1) != ESP_OK) return ESP_FAIL;
+
+    int64_t now_us = esp_timer_get_time();
+    ScanCache::Entry entry;
+    char ssid[33 * 6];
+    char chunk[sizeof(ssid) + 96];
+    for (size_t i = 0; self->m_scan_cache.get(i, entry); i++) {
+        jsonEscape(entry.ssid, ssid, sizeof(ssid));
+        int len = snprintf(chunk, sizeof(chunk),
+                           "%s{\"ssid\":\"%s\",\"bssid\":\"" MACSTR "\",\"rssi\":%d,\"channel\":%d,\"auth\":%d,\"age\":%d}",
+                           i ? "," : "", ssid, MAC2STR(entry.bssid), entry.rssi, entry.channel, (int) entry.authmode,
+                           (int) ((now_us - entry.last_seen_us) / 1000000));
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    }
+
+    httpd_resp_send_chunk(req, "]", 1);
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 /**
@@ -364,89 +1872,322 @@ esp_err_t WifiManager::resetGetHandler(httpd_req_t* req) {
     return ESP_OK;
 }
 
+/**
+ * @brief HTTP GET handler reporting the connection state and phase timings as JSON.
+ *
+ * Streams {"state":"GotIP","ip":"192.168.1.20","attempts":[...]} with one chunk per attempt,
+ * newest first. Each attempt carries its kind, result (0 = success, 255 = pending, otherwise
+ * the disconnect reason) and the scan/associate/dhcp/total durations in milliseconds.
+ * The "assets" object counts cache hits, misses, 304 answers and body bytes sent, so repeated
+ * page loads can be compared by the bytes they cost; "flash_assets" and "littlefs" give the
+ * bytes and time of the mapped-partition and filesystem paths for a throughput comparison,
+ * and "streaming" the file-streaming throughput per chunk size (see FILE_STREAM_SWEEP).
+ *
+ * @param req HTTP request handle.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t WifiManager::statusGetHandler(httpd_req_t* req) {
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
+
+    ConnectionTimingLog::Record records[ConnectionTimingLog::CAPACITY];
+    size_t count = self->getConnectionTimings(records, ConnectionTimingLog::CAPACITY);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    LinkStatus link = self->getLinkStatus();
+    char chunk[192];
+    int len = snprintf(chunk, sizeof(chunk),
+                       "{\"state\":\"%s\",\"ip\":\"" IPSTR "\",\"rssi\":%d,\"bssid\":\"" MACSTR "\",\"generation\":%" PRIu32 ",\"attempts\":[",
+                       ConnectionStateMachine::toString(link.state), IP2STR(&link.ip), link.rssi, MAC2STR(link.bssid),
+                       link.generation);
+    if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+
+    for (size_t i = 0; i < count; i++) {
+        const ConnectionTimingLog::Record& r = records[i];
+        len = snprintf(chunk, sizeof(chunk),
+                       "%s{\"seq\":%" PRIu32 ",\"kind\":\"%s\",\"result\":%u,\"channel\":%u,"
+                       "\"scan_ms\":%" PRIu32 ",\"associate_ms\":%" PRIu32 ",\"dhcp_ms\":%" PRIu32 ",\"total_ms\":%" PRIu32 "}",
+                       i ? "," : "", r.sequence, ConnectionTimingLog::toString(r.kind), r.result, r.channel,
+                       r.scan_ms, r.associate_ms, r.dhcp_ms, r.total_ms);
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    }
+
+    ProvisioningClientTracker::Stats clients = self->m_clients.getStats();
+    len = snprintf(chunk, sizeof(chunk), "],\"clients\":{\"requests\":%" PRIu32 ",\"rejected\":%" PRIu32 ",\"evicted\":%" PRIu32 ",\"serve_latency\":[",
+                   clients.requests, clients.rejected, clients.evicted);
+    if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    for (size_t i = 0; i < ProvisioningClientTracker::LATENCY_BUCKETS; i++) {
+        const ProvisioningClientTracker::Latency& l = clients.latency[i];
+        uint32_t avg_us = l.count ? (uint32_t) (l.total_us / l.count) : 0;
+        len = snprintf(chunk, sizeof(chunk), "%s{\"clients\":%u,\"count\":%" PRIu32 ",\"avg_ms\":%" PRIu32 ",\"max_ms\":%" PRIu32 "}",
+                       i ? "," : "", (unsigned) (i + 1), l.count, avg_us / 1000, l.max_us / 1000);
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    }
+
+    AssetCache::Stats assets = self->m_assets.getStats();
+    len = snprintf(chunk, sizeof(chunk), "]},\"assets\":{\"hits\":%" PRIu32 ",\"misses\":%" PRIu32 ",\"not_modified\":%" PRIu32 ",\"bytes_sent\":%" PRIu32 "}",
+                   assets.hits, assets.misses, assets.not_modified, assets.bytes_sent);
+    if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    FlashAssetStore::Stats flash = self->m_flash_assets.getStats();
+    len = snprintf(chunk, sizeof(chunk), ",\"flash_assets\":{\"hits\":%" PRIu32 ",\"not_modified\":%" PRIu32 ",\"bytes_sent\":%" PRIu32 ",\"send_us\":%" PRIu64 "},"
+                   "\"littlefs\":{\"bytes_sent\":%" PRIu32 ",\"serve_us\":%" PRIu64 "},\"streaming\":[",
+                   flash.hits, flash.not_modified, flash.bytes_sent, flash.send_us, self->m_littlefs_bytes_sent, self->m_littlefs_serve_us);
+    if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    FileStreamer::Throughput throughput[FileStreamer::SWEEP_COUNT];
+    self->m_streamer.getThroughput(throughput);
+    for (size_t i = 0; i < FileStreamer::SWEEP_COUNT; i++) {
+        const FileStreamer::Throughput& t = throughput[i];
+        uint32_t kib_per_s = t.us ? (uint32_t) ((uint64_t) t.bytes * 1000000 / 1024 / t.us) : 0;
+        len = snprintf(chunk, sizeof(chunk), "%s{\"chunk\":%u,\"responses\":%" PRIu32 ",\"bytes\":%" PRIu32 ",\"kib_per_s\":%" PRIu32 "}",
+                       i ? "," : "", (unsigned) FileStreamer::SWEEP_SIZES[i], t.responses, t.bytes, kib_per_s);
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) return ESP_FAIL;
+    }
+    if (httpd_resp_send_chunk(req, "]}", 2) != ESP_OK) return ESP_FAIL;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 /**
  * @brief HTTP GET handler for favicon.
  *
- * Returns a 204 No Content response.
+ * Serves favicon.ico from STATIC_FILES_DIR if the filesystem is already mounted (a favicon
+ * alone is not worth a mount), otherwise returns a 204 No Content response.
  *
  * @param req HTTP request handle.
  * @return esp_err_t ESP_OK on success.
  */
 esp_err_t WifiManager::faviconGetHandler(httpd_req_t *req) {
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (self->m_fs.isMounted()) {
+        esp_err_t ret = self->m_static.serve(req, "/favicon.ico");
+        if (ret != ESP_ERR_NOT_FOUND) return ret;
+    }
     httpd_resp_set_status(req, "204 No Content");
     return httpd_resp_send(req, NULL, 0);
 }
 
 /**
- * @brief Saves Wi-Fi credentials to Non-Volatile Storage (NVS).
+ * @brief HTTP GET handler for the /static/ wildcard, serving files below STATIC_FILES_DIR.
  *
- * @param ssid The SSID to save.
- * @param password The password to save.
+ * @param req HTTP request handle.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
-esp_err_t WifiManager::saveCredentials(const std::string& ssid, const std::string& password) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) return err;
+esp_err_t WifiManager::staticGetHandler(httpd_req_t* req) {
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
 
-    nvs_set_str(nvs_handle, NVS_KEY_WIFI_SSID, ssid.c_str());
-    nvs_set_str(nvs_handle, NVS_KEY_WIFI_PASS, password.c_str());
-    
-    err = nvs_commit(nvs_handle);
-    nvs_close(nvs_handle);
-    return err;
+#if FLASH_ASSETS_ENABLED
+    // The mapped store sends whole assets only; ranges are left to the filesystem path.
+    if (httpd_req_get_hdr_value_len(req, "Range") == 0) {
+        esp_err_t mapped = self->m_flash_assets.send(req, req->uri);
+        if (mapped != ESP_ERR_NOT_FOUND) return mapped == ESP_OK ? ESP_OK : ESP_FAIL;
+    }
+#endif
+    esp_err_t ret = self->m_static.serve(req, req->uri + strlen("/static"));
+    if (ret == ESP_ERR_NOT_FOUND) return httpd_resp_send_404(req);
+    return ret == ESP_OK ? ESP_OK : ESP_FAIL;
 }
 
 /**
- * @brief Loads Wi-Fi credentials from Non-Volatile Storage (NVS).
+ * @brief HTTP GET handler for OS connectivity probes; redirects to the provisioning page.
+ *
+ * Answers with an empty 302 so the probe completes in a single round trip.
  *
- * @param ssid Output parameter for the loaded SSID.
- * @param password Output parameter for the loaded password.
+ * @param req HTTP request handle.
  * @return esp_err_t ESP_OK on success, error code otherwise.
  */
-esp_err_t WifiManager::loadCredentials(std::string& ssid, std::string& password) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) return err;
+esp_err_t WifiManager::captivePortalRedirectHandler(httpd_req_t* req) {
+    WifiManager* self = static_cast<WifiManager*>(req->user_ctx);
+    if (!self->admitRequest(req)) return ESP_OK;
+    httpd_resp_set_status(req, "302 Found");
+    httpd_resp_set_hdr(req, "Location", self->m_portal_url);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, NULL, 0);
+}
 
-    size_t required_size;
-    err = nvs_get_str(nvs_handle, NVS_KEY_WIFI_SSID, NULL, &required_size);
-    if (err != ESP_OK) { nvs_close(nvs_handle); return err; }
-    std::vector<char> ssid_buf(required_size);
-    err = nvs_get_str(nvs_handle, NVS_KEY_WIFI_SSID, ssid_buf.data(), &required_size);
-    if (err != ESP_OK) { nvs_close(nvs_handle); return err; }
-    ssid = ssid_buf.data();
-    
-    err = nvs_get_str(nvs_handle, NVS_KEY_WIFI_PASS, NULL, &required_size);
-    if (err == ESP_ERR_NVS_NOT_FOUND) {
-        password = "";
-    } else if (err == ESP_OK) {
-        std::vector<char> pass_buf(required_size);
-        err = nvs_get_str(nvs_handle, NVS_KEY_WIFI_PASS, pass_buf.data(), &required_size);
-        if (err != ESP_OK) { nvs_close(nvs_handle); return err; }
-        password = pass_buf.data();
+/**
+ * @brief HTTP 404 handler in provisioning mode; redirects unknown URIs to the provisioning page.
+ *
+ * Catches probe URLs not listed in ROUTES and pages requested by name
+ * through the captive DNS.
+ *
+ * @param req HTTP request handle.
+ * @param error The error code (HTTPD_404_NOT_FOUND).
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t WifiManager::notFoundRedirectHandler(httpd_req_t* req, httpd_err_code_t error) {
+    WifiManager* self = static_cast<WifiManager*>(httpd_get_global_user_ctx(req->handle));
+    httpd_resp_set_status(req, "302 Found");
+    httpd_resp_set_hdr(req, "Location", self->m_portal_url);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+/**
+ * @struct LeaseTimeQuery
+ * @brief Input and output of readLeaseTime(), run in the TCP/IP task.
+ */
+struct LeaseTimeQuery {
+    /** @brief Station interface. */
+    esp_netif_t* netif;
+    /** @brief Output: lease duration granted by the server, in seconds. */
+    uint32_t seconds;
+};
+
+/**
+ * @brief esp_netif_tcpip_exec() callback; reads the duration of the lease the DHCP client holds.
+ *
+ * @param ctx Pointer to a LeaseTimeQuery.
+ * @return esp_err_t ESP_OK, or ESP_ERR_NOT_FOUND if the address did not come from DHCP.
+ */
+static esp_err_t readLeaseTime(void* ctx) {
+    LeaseTimeQuery* query = static_cast<LeaseTimeQuery*>(ctx);
+    struct netif* lwip_netif = static_cast<struct netif*>(esp_netif_get_netif_impl(query->netif));
+    if (!lwip_netif || !dhcp_supplied_address(lwip_netif)) return ESP_ERR_NOT_FOUND;
+    query->seconds = netif_dhcp_data(lwip_netif)->offered_t0_lease;
+    return ESP_OK;
+}
+
+/**
+ * @brief Persists an address obtained via DHCP as the active network's last lease if it changed.
+ *
+ * Writes NVS, so it runs on the connection task only. In reuse-lease mode the grant time and
+ * duration are stored too, so the next connect knows whether the lease is still valid; other
+ * modes leave them at 0 and skip the NVS write a new grant time would cause on every connect.
+ *
+ * @param netif The station network interface.
+ * @param ip_info The address of the interface.
+ */
+void WifiManager::saveLease(esp_netif_t* netif, const esp_netif_ip_info_t& ip_info) {
+    IpSettings lease = {};
+    lease.ip_info = ip_info;
+    esp_netif_dns_info_t dns = {};
+    if (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+        lease.dns = dns.ip.u_addr.ip4;
+    }
+    int64_t granted = 0;
+    LeaseTimeQuery query = {netif, 0};
+    if (m_ip_mode == IpMode::ReuseLease && esp_netif_tcpip_exec(&readLeaseTime, &query) == ESP_OK && query.seconds) {
+        granted = time(nullptr);
     } else {
-        nvs_close(nvs_handle);
-        return err;
+        query.seconds = 0;
+    }
+    if (m_active_network < 0 || (m_lease_valid && memcmp(&lease, &m_lease, sizeof(lease)) == 0 &&
+                                 granted == m_lease_granted && query.seconds == m_lease_seconds)) {
+        return;
+    }
+
+    if (m_credentials.updateLease(m_active_network, lease, granted, query.seconds) == ESP_OK) {
+        m_lease = lease;
+        m_lease_valid = true;
+        m_lease_granted = granted;
+        m_lease_seconds = query.seconds;
     }
+}
+
+/**
+ * @brief Loads the fast-connect record from NVS.
+ *
+ * @param record Output parameter for the loaded record.
+ * @return esp_err_t ESP_OK on success, error code if no valid record exists.
+ */
+esp_err_t WifiManager::loadFastConnectRecord(FastConnectRecord& record) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) return err;
 
+    size_t required_size = sizeof(record);
+    err = nvs_get_blob(nvs_handle, NVS_KEY_WIFI_FAST, &record, &required_size);
     nvs_close(nvs_handle);
+    if (err != ESP_OK) return err;
+
+    if (required_size != sizeof(record)) return ESP_ERR_INVALID_SIZE;
+    record.ssid[sizeof(record.ssid) - 1] = '\0';
     return ESP_OK;
 }
 
 /**
- * @brief Clears stored credentials and restarts the device.
+ * @brief Returns whether an auth mode authenticates with a static PMK that can be replayed.
+ *
+ * @param authmode Auth mode of the AP.
+ * @return true for WPA-PSK and WPA2-PSK; false for open, SAE (WPA3 and WPA2/WPA3) and others.
  */
-void WifiManager::clearCredentialsAndRestart() {
+static bool usesStaticPmk(wifi_auth_mode_t authmode) {
+    return authmode == WIFI_AUTH_WPA_PSK || authmode == WIFI_AUTH_WPA2_PSK || authmode == WIFI_AUTH_WPA_WPA2_PSK;
+}
+
+/**
+ * @brief Builds a fast-connect record from the current association and saves it to NVS.
+ *
+ * Stores the AP's auth mode. For WPA/WPA2-PSK, derives the PMK with PBKDF2-HMAC-SHA1 (4096
+ * iterations, SSID as salt) as specified by IEEE 802.11i; a passphrase that is already a
+ * 64-digit hex PSK is stored as-is. Other modes keep only BSSID and channel, and the
+ * directed connect sends the passphrase.
+ *
+ * @param ssid The SSID of the connected network.
+ * @param password The passphrase used to derive the PMK.
+ * @return esp_err_t ESP_OK on success, error code otherwise.
+ */
+esp_err_t WifiManager::saveFastConnectRecord(const std::string& ssid, const std::string& password) {
+    FastConnectRecord record = {};
+    strncpy(record.ssid, ssid.c_str(), sizeof(record.ssid) - 1);
+    LinkStatus link = m_link.read();
+    memcpy(record.bssid, link.bssid, sizeof(record.bssid));
+    record.channel = link.channel;
+    wifi_ap_record_t ap_info;
+    record.authmode = esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK ? ap_info.authmode : WIFI_AUTH_OPEN;
+
+    bool static_pmk = usesStaticPmk(static_cast<wifi_auth_mode_t>(record.authmode));
+    if (static_pmk && password.length() == 64) {
+        for (size_t i = 0; i < sizeof(record.pmk); i++) {
+            record.pmk[i] = (uint8_t) strtoul(password.substr(i * 2, 2).c_str(), nullptr, 16);
+        }
+        record.pmk_valid = 1;
+    } else if (static_pmk && !password.empty()) {
+        int64_t start_us = esp_timer_get_time();
+        int ret = mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA1,
+                                                (const unsigned char*) password.c_str(), password.length(),
+                                                (const unsigned char*) ssid.c_str(), ssid.length(),
+                                                4096, sizeof(record.pmk), record.pmk);
+        if (ret != 0) {
+            ESP_LOGE(TAG, "PMK derivation failed (%d)", ret);
+            return ESP_FAIL;
+        }
+        record.pmk_valid = 1;
+        ESP_LOGI(TAG, "PMK derived in %" PRId64 " ms", (esp_timer_get_time() - start_us) / 1000);
+    }
+
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        esp_restart();
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_blob(nvs_handle, NVS_KEY_WIFI_FAST, &record, sizeof(record));
+    if (err == ESP_OK) err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Fast-connect record saved (" MACSTR ", channel %d)", MAC2STR(record.bssid), record.channel);
     }
-    nvs_erase_key(nvs_handle, NVS_KEY_WIFI_SSID);
-    nvs_erase_key(nvs_handle, NVS_KEY_WIFI_PASS);
+    return err;
+}
+
+/**
+ * @brief Removes the fast-connect record from NVS.
+ */
+void WifiManager::clearFastConnectRecord() {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) return;
+    nvs_erase_key(nvs_handle, NVS_KEY_WIFI_FAST);
     nvs_commit(nvs_handle);
     nvs_close(nvs_handle);
-    
+}
+
+/**
+ * @brief Clears stored credentials and restarts the device.
+ */
+void WifiManager::clearCredentialsAndRestart() {
+    m_credentials.clear();
+    clearFastConnectRecord();
     esp_restart();
 }
\ No newline at end of file
@@ -6,6 +6,9 @@
 
 #include "Application.h"
 
+// Test builds (pio test) compile src/ too and bring their own app_main.
+#ifndef PIO_UNIT_TESTING
+
 /** @brief Global instance of the Application class. */
 Application app;
 
@@ -17,4 +20,6 @@ Application app;
  */
 extern "C" void app_main(void) {
     app.run();
-}
\ No newline at end of file
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,165 @@
+/**
+ * @file http_test_client.h
+ * @brief Loopback HTTP server and client helpers shared by the on-target test suites.
+ *
+ * The suites run on the device: they start an esp_http_server instance on TEST_HTTP_PORT
+ * and talk to it over 127.0.0.1 (CONFIG_LWIP_NETIF_LOOPBACK), so no Wi-Fi is needed. The
+ * client sends one GET per connection with Connection: close and reads the response to the
+ * end, which is what a browser loading the provisioning page over a fresh socket costs.
+ */
+
+#pragma once
+#include "sdk_compat.h"
+#include "lwip/sockets.h"
+#include <strings.h>
+
+/** @brief Port of the test server; clear of the provisioning and control servers on 80. */
+#define TEST_HTTP_PORT 8080
+
+/** @brief Receive timeout of the test client in milliseconds. */
+#define TEST_HTTP_TIMEOUT_MS 5000
+
+/**
+ * @struct HttpResult
+ * @brief What the test client saw of one response.
+ */
+struct HttpResult {
+    /** @brief Status code, 0 if the exchange failed. */
+    int status;
+    /** @brief Body bytes received after the header block. */
+    size_t body_bytes;
+    /** @brief ETag header value, empty if absent. */
+    char etag[48];
+    /** @brief Content-Encoding header value, empty if absent. */
+    char encoding[16];
+    /** @brief Start of the body, null-terminated. */
+    char body[64];
+    /** @brief Time from connect() to the last byte, in microseconds. */
+    int64_t latency_us;
+};
+
+/**
+ * @brief Starts the test server with the given handlers.
+ *
+ * The server task is pinned to core 0 so client tasks can be pinned to core 1.
+ *
+ * @param uris Handlers to register.
+ * @param count Number of entries in @p uris.
+ * @param max_sockets Concurrent sessions the server accepts.
+ * @return httpd_handle_t Server handle, or null on failure.
+ */
+static inline httpd_handle_t startTestServer(const httpd_uri_t* uris, size_t count, uint16_t max_sockets) {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = TEST_HTTP_PORT;
+    config.ctrl_port = TEST_HTTP_PORT + 1;
+    config.max_open_sockets = max_sockets;
+    config.max_uri_handlers = count;
+    config.backlog_conn = max_sockets;
+    config.core_id = 0;
+    config.lru_purge_enable = true;
+
+    httpd_handle_t server = nullptr;
+    if (httpd_start(&server, &config) != ESP_OK) return nullptr;
+    for (size_t i = 0; i < count; i++) {
+        httpd_register_uri_handler(server, &uris[i]);
+    }
+    return server;
+}
+
+/**
+ * @brief Copies the value of a header line if its name matches.
+ *
+ * @param line Start of the header line.
+ * @param end End of the line (the '\r').
+ * @param name Header name including the colon, e.g. "ETag:".
+ * @param out Destination buffer.
+ * @param out_size Size of @p out.
+ */
+static inline void copyHeader(const char* line, const char* end, const char* name, char* out, size_t out_size) {
+    size_t name_len = strlen(name);
+    if ((size_t) (end - line) < name_len || strncasecmp(line, name, name_len) != 0) return;
+    const char* value = line + name_len;
+    while (value < end && *value == ' ') value++;
+    size_t len = (size_t) (end - value);
+    if (len >= out_size) len = out_size - 1;
+    memcpy(out, value, len);
+    out[len] = '\0';
+}
+
+/**
+ * @brief Sends a GET request to the test server and reads the whole response.
+ *
+ * @param path Request path.
+ * @param headers Extra header lines, each ending in "\r\n", or null.
+ * @param result Filled with what was received; status is 0 if the exchange failed.
+ * @return true if a status line was received.
+ */
+static inline bool httpGet(const char* path, const char* headers, HttpResult* result) {
+    memset(result, 0, sizeof(*result));
+
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) return false;
+    struct timeval timeout = { .tv_sec = TEST_HTTP_TIMEOUT_MS / 1000, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_HTTP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char buffer[1024];
+    int64_t start_us = esp_timer_get_time();
+    if (connect(sock, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        close(sock);
+        return false;
+    }
+    int len = snprintf(buffer, sizeof(buffer),
+                       "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n%s\r\n",
+                       path, headers ? headers : "");
+    if (send(sock, buffer, len, 0) != len) {
+        close(sock);
+        return false;
+    }
+
+    // The header block is collected in the buffer until the blank line; everything after
+    // it is only counted, apart from the first bytes kept in result->body.
+    size_t held = 0;
+    bool in_body = false;
+    for (;;) {
+        int received = recv(sock, buffer + held, sizeof(buffer) - 1 - held, 0);
+        if (received <= 0) break;
+        if (in_body) {
+            if (result->body_bytes < sizeof(result->body) - 1) {
+                size_t keep = sizeof(result->body) - 1 - result->body_bytes;
+                memcpy(result->body + result->body_bytes, buffer, (size_t) received < keep ? (size_t) received : keep);
+            }
+            result->body_bytes += received;
+            continue;
+        }
+        held += received;
+        buffer[held] = '\0';
+        char* blank = strstr(buffer, "\r\n\r\n");
+        if (!blank) {
+            if (held == sizeof(buffer) - 1) break;
+            continue;
+        }
+
+        sscanf(buffer, "HTTP/1.%*d %d", &result->status);
+        for (char* line = strstr(buffer, "\r\n"); line && line < blank; line = strstr(line, "\r\n")) {
+            line += 2;
+            char* end = strstr(line, "\r\n");
+            copyHeader(line, end, "ETag:", result->etag, sizeof(result->etag));
+            copyHeader(line, end, "Content-Encoding:", result->encoding, sizeof(result->encoding));
+        }
+
+        in_body = true;
+        char* body = blank + 4;
+        result->body_bytes = held - (size_t) (body - buffer);
+        size_t keep = result->body_bytes < sizeof(result->body) - 1 ? result->body_bytes : sizeof(result->body) - 1;
+        memcpy(result->body, body, keep);
+        held = 0;
+    }
+    result->latency_us = esp_timer_get_time() - start_us;
+    close(sock);
+    return result->status != 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file test_main.cpp
+ * @brief On-target tests of the AssetCache validators and byte counts.
+ *
+ * Writes a page of TEST_PAGE_SIZE bytes to LittleFS, caches it and serves it on /page through
+ * AssetCache::send(), then loads it over loopback (see http_test_client.h) the way a browser
+ * reloads the provisioning page: the first load is unconditional, later ones send the ETag
+ * back in If-None-Match. /probe reports what acceptsGzip() and matchesIfNoneMatch() make of
+ * the request headers.
+ *
+ * Run with: pio test -e esp32doit-devkit-v1 -f test_asset_cache
+ */
+
+#include <unity.h>
+#include <cstdio>
+#include <unistd.h>
+#include "LazyFileSystem.h"
+#include "AssetCache.h"
+#include "../http_test_client.h"
+
+/** @brief Size of the test page. */
+static const size_t TEST_PAGE_SIZE = 4096;
+
+/** @brief Test page on the storage partition; removed when the run ends. */
+static const char* const TEST_FILE = LFS_BASE_PATH "/test_page.html";
+
+/** @brief ETag /probe checks If-None-Match against. */
+static const char* const PROBE_ETAG = "\"0badcafe\"";
+
+/** @brief Page loads in the repeated-load test. */
+static const int TEST_RELOADS = 5;
+
+static LazyFileSystem s_fs;
+
+/** @brief The test page as the only cached asset. */
+static const AssetCache::Asset TEST_ASSETS[] = {
+    {"/page", "/test_page.html", "text/html", nullptr},
+};
+static AssetCache s_cache(s_fs, TEST_ASSETS, 1);
+
+static httpd_handle_t s_server;
+
+/**
+ * @brief Serves the test page from the cache.
+ */
+static esp_err_t pageHandler(httpd_req_t* req) {
+    esp_err_t ret = s_cache.send(req, "/page");
+    return ret == ESP_ERR_NOT_FOUND ? httpd_resp_send_404(req) : ret;
+}
+
+/**
+ * @brief Answers "gzip=<0|1> match=<0|1>" for the request's Accept-Encoding and If-None-Match.
+ */
+static esp_err_t probeHandler(httpd_req_t* req) {
+    char body[32];
+    snprintf(body, sizeof(body), "gzip=%d match=%d",
+             AssetCache::acceptsGzip(req), AssetCache::matchesIfNoneMatch(req, PROBE_ETAG));
+    return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief Writes the test page: printable filler with a line break every 64 bytes.
+ *
+ * @return true if the whole page was written.
+ */
+static bool writeTestPage() {
+    FILE* file = fopen(TEST_FILE, "w");
+    if (!file) return false;
+    size_t written = 0;
+    for (size_t i = 0; i < TEST_PAGE_SIZE; i++) {
+        written += fputc(i % 64 == 63 ? '\n' : 'A' + (char) (i % 26), file) != EOF;
+    }
+    return fclose(file) == 0 && written == TEST_PAGE_SIZE;
+}
+
+/**
+ * @brief Loads /page unconditionally and checks it arrived whole with an ETag.
+ *
+ * @param result Filled with the response.
+ */
+static void loadPage(HttpResult* result) {
+    TEST_ASSERT_TRUE(httpGet("/page", nullptr, result));
+    TEST_ASSERT_EQUAL_INT(200, result->status);
+    TEST_ASSERT_EQUAL_UINT32(TEST_PAGE_SIZE, result->body_bytes);
+    TEST_ASSERT_NOT_EQUAL(0, strlen(result->etag));
+}
+
+/**
+ * @brief Sends /page with the given If-None-Match value and returns the status.
+ *
+ * @param validator Header value.
+ * @param result Filled with the response.
+ */
+static int revalidate(const char* validator, HttpResult* result) {
+    char headers[96];
+    snprintf(headers, sizeof(headers), "If-None-Match: %s\r\n", validator);
+    TEST_ASSERT_TRUE(httpGet("/page", headers, result));
+    return result->status;
+}
+
+/**
+ * @brief Sends /probe with the given header lines and returns the body.
+ *
+ * @param headers Header lines, or null.
+ * @param result Filled with the response.
+ */
+static const char* probe(const char* headers, HttpResult* result) {
+    TEST_ASSERT_TRUE(httpGet("/probe", headers, result));
+    TEST_ASSERT_EQUAL_INT(200, result->status);
+    return result->body;
+}
+
+/**
+ * @brief The ETag depends only on the content: it stays the same across loads and reloads of the buffer.
+ */
+static void test_etag_is_stable_across_loads() {
+    HttpResult first, second, reloaded;
+    loadPage(&first);
+    loadPage(&second);
+    TEST_ASSERT_EQUAL_STRING(first.etag, second.etag);
+
+    uint32_t loads = s_cache.getStats().loads;
+    s_cache.invalidate();
+    loadPage(&reloaded);
+    TEST_ASSERT_EQUAL_UINT32(loads + 1, s_cache.getStats().loads);
+    TEST_ASSERT_EQUAL_STRING(first.etag, reloaded.etag);
+}
+
+/**
+ * @brief A matching If-None-Match is answered with 304, the same ETag and no body.
+ */
+static void test_if_none_match_gets_304_without_body() {
+    HttpResult page, result;
+    loadPage(&page);
+    uint32_t not_modified = s_cache.getStats().not_modified;
+
+    TEST_ASSERT_EQUAL_INT(304, revalidate(page.etag, &result));
+    TEST_ASSERT_EQUAL_UINT32(0, result.body_bytes);
+    TEST_ASSERT_EQUAL_STRING(page.etag, result.etag);
+    TEST_ASSERT_EQUAL_UINT32(not_modified + 1, s_cache.getStats().not_modified);
+}
+
+/**
+ * @brief Weak validators, "*" and lists match; a different ETag gets the full page.
+ */
+static void test_weak_wildcard_and_list_validators() {
+    HttpResult page, result;
+    loadPage(&page);
+
+    char validator[64];
+    snprintf(validator, sizeof(validator), "W/%s", page.etag);
+    TEST_ASSERT_EQUAL_INT(304, revalidate(validator, &result));
+    TEST_ASSERT_EQUAL_INT(304, revalidate("*", &result));
+    snprintf(validator, sizeof(validator), "\"00000000\", %s", page.etag);
+    TEST_ASSERT_EQUAL_INT(304, revalidate(validator, &result));
+
+    TEST_ASSERT_EQUAL_INT(200, revalidate("\"00000000\"", &result));
+    TEST_ASSERT_EQUAL_UINT32(TEST_PAGE_SIZE, result.body_bytes);
+
+    TEST_ASSERT_EQUAL_STRING("gzip=0 match=1", probe("If-None-Match: W/\"0badcafe\"\r\n", &result));
+    TEST_ASSERT_EQUAL_STRING("gzip=0 match=0", probe("If-None-Match: \"0badcaff\"\r\n", &result));
+    TEST_ASSERT_EQUAL_STRING("gzip=0 match=0", probe(nullptr, &result));
+}
+
+/**
+ * @brief Over repeated page loads only the first one sends the body; bytes_sent grows on 200s alone.
+ */
+static void test_bytes_sent_over_repeated_loads() {
+    AssetCache::Stats before = s_cache.getStats();
+    size_t received = 0;
+
+    HttpResult page, result;
+    loadPage(&page);
+    received += page.body_bytes;
+    TEST_ASSERT_EQUAL_UINT32(before.bytes_sent + TEST_PAGE_SIZE, s_cache.getStats().bytes_sent);
+
+    for (int i = 1; i < TEST_RELOADS; i++) {
+        TEST_ASSERT_EQUAL_INT(304, revalidate(page.etag, &result));
+        received += result.body_bytes;
+        TEST_ASSERT_EQUAL_UINT32(before.bytes_sent + TEST_PAGE_SIZE, s_cache.getStats().bytes_sent);
+    }
+
+    AssetCache::Stats after = s_cache.getStats();
+    TEST_ASSERT_EQUAL_UINT32(TEST_PAGE_SIZE, received);
+    TEST_ASSERT_EQUAL_UINT32(TEST_RELOADS - 1, after.not_modified - before.not_modified);
+    printf("%d page loads: %u body bytes sent, %u without validators\n", TEST_RELOADS,
+           (unsigned) (after.bytes_sent - before.bytes_sent), (unsigned) (TEST_RELOADS * TEST_PAGE_SIZE));
+}
+
+/**
+ * @brief Accept-Encoding parsing: gzip counts unless its q-value is zero.
+ */
+static void test_accepts_gzip() {
+    HttpResult result;
+    TEST_ASSERT_EQUAL_STRING("gzip=1 match=0", probe("Accept-Encoding: gzip, deflate, br\r\n", &result));
+    TEST_ASSERT_EQUAL_STRING("gzip=1 match=0", probe("Accept-Encoding: deflate, gzip;q=0.5\r\n", &result));
+    TEST_ASSERT_EQUAL_STRING("gzip=0 match=0", probe("Accept-Encoding: gzip;q=0\r\n", &result));
+    TEST_ASSERT_EQUAL_STRING("gzip=0 match=0", probe("Accept-Encoding: br\r\n", &result));
+    TEST_ASSERT_EQUAL_STRING("gzip=0 match=0", probe(nullptr, &result));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+extern "C" void app_main(void) {
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(s_fs.ensureMounted());
+    if (!writeTestPage()) ESP_ERROR_CHECK(ESP_FAIL);
+
+    const httpd_uri_t uris[] = {
+        {.uri = "/page", .method = HTTP_GET, .handler = pageHandler, .user_ctx = nullptr},
+        {.uri = "/probe", .method = HTTP_GET, .handler = probeHandler, .user_ctx = nullptr},
+    };
+    s_server = startTestServer(uris, sizeof(uris) / sizeof(uris[0]), 2);
+    if (!s_server) ESP_ERROR_CHECK(ESP_FAIL);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_etag_is_stable_across_loads);
+    RUN_TEST(test_if_none_match_gets_304_without_body);
+    RUN_TEST(test_weak_wildcard_and_list_validators);
+    RUN_TEST(test_bytes_sent_over_repeated_loads);
+    RUN_TEST(test_accepts_gzip);
+    UNITY_END();
+
+    httpd_stop(s_server);
+    unlink(TEST_FILE);
+}
@@ -0,0 +1,349 @@
+/**
+ * @file test_main.cpp
+ * @brief On-target benchmark of provisioning page serving.
+ *
+ * Serves a page of BENCH_PAGE_SIZE bytes from each source provisioningGetHandler can use
+ * (see SOURCES) and loads it from 1, 2 and 4 concurrent loopback clients (see
+ * http_test_client.h). The server runs on core 0 and every client is a task on core 1
+ * fetching the page BENCH_REQUESTS_PER_CLIENT times over fresh connections, as a browser
+ * does over the SoftAP. Results are printed as tables; the tests fail if any response is
+ * not a complete 200.
+ *
+ * Every handler is timed from entry to return, which leaves out connection setup and the
+ * client, so the sources can be compared by what serving the page costs the server. Besides
+ * esp_timer microseconds the handler records esp_cpu_get_cycle_count() deltas of the server
+ * core. Those include cycles other core-0 tasks (mostly lwIP) run while the handler waits in
+ * a send, so cycles per byte is the CPU share the serve path occupies, not handler
+ * instructions alone.
+ *
+ * The flash source serves index.html from the memory-mapped asset partition and is left out
+ * if the partition holds no image. Its page size differs from BENCH_PAGE_SIZE, so compare
+ * sources by KiB/s and cycles per byte rather than latency.
+ *
+ * Run with: pio test -e esp32doit-devkit-v1 -f test_serve_benchmark
+ */
+
+#include <unity.h>
+#include <cstdio>
+#include <unistd.h>
+#include "LazyFileSystem.h"
+#include "FileStreamer.h"
+#include "AssetCache.h"
+#include "FlashAssetStore.h"
+#include "esp_cpu.h"
+#include "../http_test_client.h"
+
+/** @brief Size of the benchmark page, close to the minified provisioning page. */
+static const size_t BENCH_PAGE_SIZE = 12 * 1024;
+
+/** @brief Benchmark page on the storage partition; removed when the run ends. */
+static const char* const BENCH_FILE = LFS_BASE_PATH "/bench_page.html";
+
+/** @brief Sequential requests each client makes per run. */
+static const int BENCH_REQUESTS_PER_CLIENT = 20;
+
+/** @brief Concurrent client counts to measure. */
+static const int BENCH_CLIENT_COUNTS[] = {1, 2, 4};
+
+/** @brief Largest entry of BENCH_CLIENT_COUNTS; the server gets one session per client. */
+static const int BENCH_MAX_CLIENTS = 4;
+
+/** @brief Requests made from one client when comparing sources. */
+static const int BENCH_COMPARE_REQUESTS = 50;
+
+/** @brief Longest a run may take before the test gives up on its clients, in milliseconds. */
+static const uint32_t BENCH_RUN_TIMEOUT_MS = 60000;
+
+/**
+ * @struct Source
+ * @brief One way of serving the page, registered under its own URI.
+ */
+struct Source {
+    /** @brief Name printed in the tables. */
+    const char* name;
+    /** @brief URI the handler is registered under. */
+    const char* uri;
+    /** @brief Handler serving the page. */
+    esp_err_t (*handler)(httpd_req_t* req);
+};
+
+/**
+ * @struct ClientRun
+ * @brief Work and results of one client task.
+ */
+struct ClientRun {
+    /** @brief URI to fetch. */
+    const char* uri;
+    /** @brief Requests to make. */
+    int requests;
+    /** @brief Body size of a complete response. */
+    size_t expected;
+    /** @brief Responses that were not a complete 200. */
+    int failures;
+    /** @brief Complete responses. */
+    int completed;
+    /** @brief Fastest response, in microseconds. */
+    int64_t min_us;
+    /** @brief Slowest response, in microseconds. */
+    int64_t max_us;
+    /** @brief Sum of all response times, in microseconds. */
+    int64_t total_us;
+    /** @brief Given when the task has finished. */
+    SemaphoreHandle_t done;
+};
+
+/**
+ * @struct ServeStats
+ * @brief Server-side totals of one source; only written by the httpd task.
+ */
+struct ServeStats {
+    /** @brief Handler calls that returned ESP_OK. */
+    uint32_t responses;
+    /** @brief Time spent in the handler, in microseconds. */
+    uint64_t us;
+    /** @brief Server core cycles spent in the handler. */
+    uint64_t cycles;
+};
+
+/** @brief Per-task results; static so a timed-out task never writes to a dead stack frame. */
+static ClientRun s_runs[BENCH_MAX_CLIENTS];
+
+static LazyFileSystem s_fs;
+static FileStreamer s_streamer;
+
+/** @brief The benchmark page as the only cached asset. */
+static const AssetCache::Asset BENCH_ASSETS[] = {
+    {"/bench", "/bench_page.html", "text/html", nullptr},
+};
+static AssetCache s_cache(s_fs, BENCH_ASSETS, 1);
+
+static FlashAssetStore s_flash;
+
+static httpd_handle_t s_server;
+
+/**
+ * @brief Streams the page from LittleFS, the path provisioningGetHandler falls back to.
+ */
+static esp_err_t littlefsHandler(httpd_req_t* req) {
+    FileStreamer::Response response;
+    response.type = "text/html";
+    return s_streamer.sendFile(req, BENCH_FILE, response);
+}
+
+/**
+ * @brief Sends the page from the AssetCache with one httpd_resp_send().
+ */
+static esp_err_t cacheHandler(httpd_req_t* req) {
+    esp_err_t ret = s_cache.send(req, "/bench");
+    return ret == ESP_ERR_NOT_FOUND ? httpd_resp_send_404(req) : ret;
+}
+
+/**
+ * @brief Sends index.html from the memory-mapped asset partition.
+ */
+static esp_err_t flashHandler(httpd_req_t* req) {
+    esp_err_t ret = s_flash.send(req, "/index.html");
+    return ret == ESP_ERR_NOT_FOUND ? httpd_resp_send_404(req) : ret;
+}
+
+/** @brief Ways of serving the page under test; the first one is the baseline. */
+static const Source SOURCES[] = {
+    {"littlefs", "/littlefs", littlefsHandler},
+    {"cache", "/cache", cacheHandler},
+    {"flash", "/flash", flashHandler},
+};
+
+/** @brief Number of entries in SOURCES. */
+static const size_t SOURCE_COUNT = sizeof(SOURCES) / sizeof(SOURCES[0]);
+
+/** @brief Server-side totals, indexed like SOURCES. */
+static ServeStats s_serve[SOURCE_COUNT];
+
+/** @brief Body size each source sends, indexed like SOURCES; 0 if the source is unavailable. */
+static size_t s_page_bytes[SOURCE_COUNT];
+
+/**
+ * @brief Registered handler of every source: times the source's handler.
+ *
+ * @param req HTTP request handle; user_ctx is the index into SOURCES.
+ */
+static esp_err_t timedHandler(httpd_req_t* req) {
+    size_t index = (size_t) req->user_ctx;
+    int64_t start_us = esp_timer_get_time();
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+    esp_err_t ret = SOURCES[index].handler(req);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;  // wraps after seconds, not within a response
+    if (ret == ESP_OK) {
+        s_serve[index].responses++;
+        s_serve[index].us += esp_timer_get_time() - start_us;
+        s_serve[index].cycles += cycles;
+    }
+    return ret;
+}
+
+/**
+ * @brief Writes the benchmark page: printable filler with a line break every 64 bytes.
+ *
+ * @return true if the whole page was written.
+ */
+static bool writeBenchPage() {
+    FILE* file = fopen(BENCH_FILE, "w");
+    if (!file) return false;
+    size_t written = 0;
+    for (size_t i = 0; i < BENCH_PAGE_SIZE; i++) {
+        written += fputc(i % 64 == 63 ? '\n' : 'a' + (char) (i % 26), file) != EOF;
+    }
+    return fclose(file) == 0 && written == BENCH_PAGE_SIZE;
+}
+
+/**
+ * @brief Client task: fetches the page ClientRun::requests times and records the latencies.
+ *
+ * @param arg The task's ClientRun.
+ */
+static void clientTask(void* arg) {
+    ClientRun* run = static_cast<ClientRun*>(arg);
+    for (int i = 0; i < run->requests; i++) {
+        HttpResult result;
+        if (!httpGet(run->uri, nullptr, &result) || result.status != 200 ||
+            result.body_bytes != run->expected) {
+            run->failures++;
+            continue;
+        }
+        run->completed++;
+        run->total_us += result.latency_us;
+        if (run->min_us == 0 || result.latency_us < run->min_us) run->min_us = result.latency_us;
+        if (result.latency_us > run->max_us) run->max_us = result.latency_us;
+    }
+    xSemaphoreGive(run->done);
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Runs @p clients concurrent client tasks against one source.
+ *
+ * @param source Index into SOURCES.
+ * @param clients Number of client tasks.
+ * @param requests Requests per client.
+ * @param wall_us Set to the time until the last client finished, in microseconds.
+ * @return ClientRun Totals of all clients; min_us and max_us over all of them.
+ */
+static ClientRun runClients(size_t source, int clients, int requests, int64_t* wall_us) {
+    memset(s_runs, 0, sizeof(s_runs));
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(clients, 0);
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < clients; i++) {
+        s_runs[i].uri = SOURCES[source].uri;
+        s_runs[i].requests = requests;
+        s_runs[i].expected = s_page_bytes[source];
+        s_runs[i].done = done;
+        xTaskCreatePinnedToCore(clientTask, "bench_client", 4096, &s_runs[i], 5, nullptr, 1);
+    }
+    for (int i = 0; i < clients; i++) {
+        TEST_ASSERT_TRUE_MESSAGE(xSemaphoreTake(done, pdMS_TO_TICKS(BENCH_RUN_TIMEOUT_MS)), "client task timed out");
+    }
+    *wall_us = esp_timer_get_time() - start_us;
+    vSemaphoreDelete(done);
+
+    ClientRun total = {};
+    for (int i = 0; i < clients; i++) {
+        total.failures += s_runs[i].failures;
+        total.completed += s_runs[i].completed;
+        total.total_us += s_runs[i].total_us;
+        if (total.min_us == 0 || (s_runs[i].min_us != 0 && s_runs[i].min_us < total.min_us)) total.min_us = s_runs[i].min_us;
+        if (s_runs[i].max_us > total.max_us) total.max_us = s_runs[i].max_us;
+    }
+    return total;
+}
+
+/**
+ * @brief Page-serve latency and aggregate throughput at 1, 2 and 4 concurrent clients.
+ */
+static void test_latency_by_client_count() {
+    printf("\n%-10s %7s %8s %8s %8s %8s %8s %8s\n",
+           "source", "clients", "requests", "min ms", "avg ms", "max ms", "req/s", "KiB/s");
+    for (size_t s = 0; s < SOURCE_COUNT; s++) {
+        if (s_page_bytes[s] == 0) continue;
+        for (int clients : BENCH_CLIENT_COUNTS) {
+            int64_t wall_us;
+            ClientRun total = runClients(s, clients, BENCH_REQUESTS_PER_CLIENT, &wall_us);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(0, total.failures, "incomplete responses");
+            printf("%-10s %7d %8d %8.2f %8.2f %8.2f %8.1f %8.1f\n", SOURCES[s].name, clients, total.completed,
+                   total.min_us / 1000.0, total.total_us / 1000.0 / total.completed, total.max_us / 1000.0,
+                   total.completed * 1e6 / wall_us,
+                   (double) total.completed * s_page_bytes[s] / 1024.0 * 1e6 / wall_us);
+        }
+    }
+}
+
+/**
+ * @brief Comparison of the sources from one client: latency, throughput and CPU time.
+ *
+ * "client ms" is what the browser waits for, including the connection; "serve us" and the
+ * cycle counts are the handler alone. The speedup compares KiB/s with the baseline's, since
+ * the flash page has its own size.
+ */
+static void test_sources_against_littlefs() {
+    memset(s_serve, 0, sizeof(s_serve));
+    double client_ms[SOURCE_COUNT];
+    for (size_t s = 0; s < SOURCE_COUNT; s++) {
+        if (s_page_bytes[s] == 0) continue;
+        int64_t wall_us;
+        ClientRun total = runClients(s, 1, BENCH_COMPARE_REQUESTS, &wall_us);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, total.failures, "incomplete responses");
+        TEST_ASSERT_EQUAL_UINT32(BENCH_COMPARE_REQUESTS, s_serve[s].responses);
+        client_ms[s] = total.total_us / 1000.0 / total.completed;
+    }
+
+    printf("\n%-10s %7s %9s %9s %9s %8s %10s %8s\n",
+           "source", "bytes", "client ms", "serve us", "KiB/s", "speedup", "cycles", "cyc/B");
+    double baseline_kib_s = s_page_bytes[0] / 1024.0 * 1e6 * s_serve[0].responses / s_serve[0].us;
+    for (size_t s = 0; s < SOURCE_COUNT; s++) {
+        if (s_page_bytes[s] == 0) {
+            printf("%-10s (not available)\n", SOURCES[s].name);
+            continue;
+        }
+        double serve_us = (double) s_serve[s].us / s_serve[s].responses;
+        double kib_s = s_page_bytes[s] / 1024.0 * 1e6 / serve_us;
+        double cycles = (double) s_serve[s].cycles / s_serve[s].responses;
+        printf("%-10s %7u %9.2f %9.0f %9.1f %7.2fx %10.0f %8.1f\n", SOURCES[s].name,
+               (unsigned) s_page_bytes[s], client_ms[s], serve_us, kib_s, kib_s / baseline_kib_s,
+               cycles, cycles / s_page_bytes[s]);
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+extern "C" void app_main(void) {
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(s_fs.ensureMounted());
+    if (!writeBenchPage()) ESP_ERROR_CHECK(ESP_FAIL);
+    ESP_ERROR_CHECK(s_cache.load());
+
+    httpd_uri_t uris[SOURCE_COUNT];
+    for (size_t s = 0; s < SOURCE_COUNT; s++) {
+        uris[s] = {.uri = SOURCES[s].uri, .method = HTTP_GET, .handler = timedHandler, .user_ctx = (void*) s};
+    }
+    s_server = startTestServer(uris, SOURCE_COUNT, BENCH_MAX_CLIENTS);
+    if (!s_server) ESP_ERROR_CHECK(ESP_FAIL);
+
+    s_page_bytes[0] = BENCH_PAGE_SIZE;
+    s_page_bytes[1] = BENCH_PAGE_SIZE;
+    // The mapped image is built from data/, so its page size is only known once served.
+    HttpResult probe;
+    if (s_flash.begin() == ESP_OK && httpGet("/flash", nullptr, &probe) && probe.status == 200) {
+        s_page_bytes[2] = probe.body_bytes;
+    } else {
+        printf("Asset partition holds no index.html; flash source skipped\n");
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_latency_by_client_count);
+    RUN_TEST(test_sources_against_littlefs);
+    UNITY_END();
+
+    httpd_stop(s_server);
+    unlink(BENCH_FILE);
+}